@@ -0,0 +1,94 @@
+#include "os.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace path = os::path;
+
+// Copy through iostream buffers, as `os::path::_private::copyFile()` did before the kernel fast path
+bool streamCopyFile(const std::filesystem::path& from, const std::filesystem::path& to)
+{
+    std::ifstream source(from, std::ios::binary);
+    std::ofstream destination(to, std::ios::binary);
+    destination << source.rdbuf();
+    return static_cast<bool>(destination);
+}
+
+void makeFile(const std::filesystem::path& file, std::uintmax_t size)
+{
+    std::mt19937_64 rng(size);
+    std::vector<std::uint64_t> block(1024 * 1024 / sizeof(std::uint64_t));
+    std::ofstream out(file, std::ios::binary);
+    for(std::uintmax_t written = 0; written < size; written += block.size() * sizeof(std::uint64_t)) {
+        for(auto& i : block) {
+            i = rng();
+        }
+        out.write(reinterpret_cast<const char*>(block.data()), std::min<std::uintmax_t>(size - written, block.size() * sizeof(std::uint64_t)));
+    }
+}
+
+std::string methodName(path::CopyMethod method)
+{
+    switch(method) {
+        case path::CopyMethod::CopyFileRange:
+            return "copy_file_range";
+        case path::CopyMethod::SendFile:
+            return "sendfile";
+        case path::CopyMethod::ReadWrite:
+            return "read/write";
+        default:
+            return "stream";
+    }
+}
+
+template<typename Function>
+double secondsPerCopy(int iterations, Function copy)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) {
+        copy();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+/*
+    Compares `os::path::copyFile()` with the old stream copy on files from 1 KB to 1 GB.
+
+    Usage: copy_benchmark [directory] [max size in bytes]
+*/
+int main(int argc, char** argv)
+{
+    std::filesystem::path directory = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::temp_directory_path();
+    std::uintmax_t max_size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024ull * 1024 * 1024;
+    std::filesystem::path source = directory / "ctemplate_copy_benchmark_source";
+    std::filesystem::path destination = directory / "ctemplate_copy_benchmark_destination";
+
+    std::cout << std::left << std::setw(12) << "Size" << std::setw(16) << "Stream (MB/s)" 
+              << std::setw(16) << "copyFile (MB/s)" << std::setw(10) << "Speedup" << "Method" << std::endl;
+
+    for(std::uintmax_t size = 1024; size <= max_size; size *= 32) {
+        makeFile(source, size);
+
+        // Copy about 256 MB per measurement
+        int iterations = static_cast<int>(std::max<std::uintmax_t>(1, std::min<std::uintmax_t>(10000, (256ull * 1024 * 1024) / size)));
+
+        path::CopyMethod method = path::CopyMethod::Stream;
+        double stream_time = secondsPerCopy(iterations, [&]() { streamCopyFile(source, destination); });
+        double copy_time = secondsPerCopy(iterations, [&]() { path::copyFile(source, destination, &method); });
+
+        double megabytes = size / (1024.0 * 1024.0);
+        std::cout << std::left << std::setw(12) << (std::to_string(size / 1024) + " KB") << std::fixed << std::setprecision(1)
+                  << std::setw(16) << megabytes / stream_time << std::setw(16) << megabytes / copy_time
+                  << std::setw(10) << stream_time / copy_time << methodName(method) << std::endl;
+    }
+
+    std::filesystem::remove(source);
+    std::filesystem::remove(destination);
+    return 0;
+}
\ No newline at end of file
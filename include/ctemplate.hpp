@@ -4,21 +4,23 @@
 #include <vector>
 #include <unordered_map>
 #include <set>
+#include "helper.hpp"
 
-void initTemplate(const std::string& template_to_init, const std::set<std::string>& paths, const std::string& template_files_container_name, 
+void initTemplate(const std::string& template_to_init, const pathtable::PathTable& paths, const std::string& template_files_container_name, 
                   const std::string& path_to_init_template_to, const std::unordered_map<std::string, std::string>& keyval,
-                  bool force_overwrite = false);
-void initTemplate(const std::string& template_dir, const std::string& template_name, const std::set<std::string>& paths, const std::string& template_files_container_name, 
+                  bool force_overwrite = false, helper::LinkMode link_mode = helper::LinkMode::Copy);
+void initTemplate(const std::string& template_dir, const std::string& template_name, const pathtable::PathTable& paths, const std::string& template_files_container_name, 
                   const std::string& path_to_init_template_to, const std::unordered_map<std::string, std::string>& keyval,
-                  bool force_overwrite = false);
+                  bool force_overwrite = false, helper::LinkMode link_mode = helper::LinkMode::Copy);
 void initTemplate(const std::string& template_to_init, const std::string& template_files_container_name, 
                   const std::string& path_to_init_template_to, const std::unordered_map<std::string, std::string>& keyval,
-                  bool force_overwrite = false);
+                  bool force_overwrite = false, helper::LinkMode link_mode = helper::LinkMode::Copy);
 void initTemplate(const std::string& template_dir, const std::string& template_name,
                   const std::string& template_files_container_name, const std::string& path_to_init_template_to, 
-                  const std::unordered_map<std::string, std::string>& keyval, bool force_overwrite = false);
+                  const std::unordered_map<std::string, std::string>& keyval, bool force_overwrite = false, helper::LinkMode link_mode = helper::LinkMode::Copy);
 void addTemplate(const std::string& template_dir, const std::string& path_to_add, const std::string& name,
                  const std::string& author, const std::string& desc, const std::string& container_name);
 void removeTemplates(const std::string& template_dir, const std::vector<std::string>& templates);
+void collectGarbage(const std::string& template_dir);
 void listTemplates(const std::string& template_dir, const std::string& container_name);
 void printTemplateInfo(const std::string& template_dir, const std::string& template_name, const std::string& container_name);
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include "json.hpp"
 
 namespace global {
@@ -12,5 +13,10 @@ namespace global {
     extern nlohmann::json template_info_config;
     extern nlohmann::json template_variables_config;
     extern std::string cache_container_name;
+    extern std::string manifest_name;
+    extern std::string trash_name;
+    extern std::uintmax_t stream_threshold;
+    extern std::size_t stream_chunk_size;
+    extern unsigned int thread_count;
     
 }
\ No newline at end of file
@@ -1,12 +1,80 @@
 #pragma once
 
 #include "json.hpp"
+#include "varmatch.hpp"
+#include "pathtable.hpp"
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <array>
+#include <string_view>
+#include <cstdint>
+#include <mutex>
+#include <functional>
 
 namespace helper {
+
+    // How a template file that is not substituted is put into a project.
+    enum class LinkMode {Copy, Hard, Symbolic};
+
+    /*
+        Positions of the variables in the files of a template, cached so that files that did not change
+        since the last initialization are spliced without being scanned again.
+    */
+    class SubstitutionPlan {
+        private:
+            struct Entry {
+                std::uintmax_t size = 0;
+                long long mtime = 0;
+                bool binary = false;
+                std::vector<std::array<std::size_t, 3>> variables; // Offset, length and name index of each variable
+            };
+
+            const varmatch::Matcher& matcher_;
+            std::uintmax_t max_file_size_;
+            std::vector<std::string> names_;
+            std::vector<std::size_t> ids_; // Index of each name in the matcher
+            std::unordered_map<std::string, std::size_t> name_indices_;
+            std::unordered_map<std::string, Entry> files_;
+            bool changed_ = false;
+            std::mutex mutex_;
+
+            std::size_t nameIndex(std::string_view name);
+
+        public:
+            SubstitutionPlan(const varmatch::Matcher& matcher, std::uintmax_t max_file_size = 0);
+
+            void load(const std::string& plan_file);
+            void save(const std::string& plan_file) const;
+            bool changed() const;
+            bool replaceVariablesInFile(const std::string& key, const std::string& source_path, const std::string& destination_path,
+                                        LinkMode link_mode = LinkMode::Copy);
+    };
+
+    /*
+        Include and exclude patterns that select paths of a template, split once into patterns and non-patterns.
+        Besides matching a path, it tells when no path inside a directory can match, so the directory is not walked.
+    */
+    class PathFilter {
+        private:
+            std::set<std::string> pattern_includes_;
+            std::set<std::string> pattern_excludes_;
+            std::unordered_set<std::string> non_pattern_includes_;
+            std::unordered_set<std::string> non_pattern_excludes_;
+            std::unordered_set<std::string> include_parents_; // Directories that hold a non-pattern include
+            std::vector<std::vector<std::string>> include_segments_; // Segments of each pattern include
+            std::vector<std::vector<std::string>> excluded_trees_; // Segments before the `**` of excludes such as "build/**"
+
+        public:
+            PathFilter(const std::pair<std::set<std::string>, std::unordered_set<std::string>>& includes,
+                       const std::pair<std::set<std::string>, std::unordered_set<std::string>>& excludes);
+            PathFilter(const std::set<std::string>& include, const std::set<std::string>& exclude);
+
+            bool matches(const std::string& path) const;
+            bool skipsContents(const std::string& directory) const;
+    };
+
     void printKeyval(const std::unordered_map<std::string, std::string>& keyval);
     void showConfig(const nlohmann::json& config);
     void setConfigValue(nlohmann::json& config, const std::vector<std::string>& config_key_values);
@@ -59,24 +127,54 @@ namespace helper {
     std::unordered_map<std::string, std::string> mapKeyValues(const std::vector<std::string>& keyvals);
     bool equalVariables(const nlohmann::json& j, const std::unordered_map<std::string, std::string>& keyvals, bool error_message = false);
     bool isTemplate(const std::string& template_path, const std::string& container_name);
+    bool isBinaryData(const char* data, std::size_t size);
     
+    std::string replaceVariables(const std::string& str, const varmatch::Matcher& matcher);
+    void replaceVariables(std::string_view str, const varmatch::Matcher& matcher, varmatch::Sink& sink);
+    void replaceVariables(const std::vector<std::string_view>& chunks, const varmatch::Matcher& matcher, varmatch::Sink& sink);
     std::string replaceVariables(const std::string& str, 
                                 const std::unordered_map<std::string, std::string>& keyval, 
                                 const std::string& prefix, const std::string& suffix);
 
-    void replaceVariablesInFile(const std::string& file_path, 
+    void replaceVariablesInStream(std::istream& in, std::ostream& out, const varmatch::Matcher& matcher, std::size_t chunk_size);
+    void replaceVariablesInStream(const char* data, std::size_t size, std::ostream& out, const varmatch::Matcher& matcher, std::size_t chunk_size);
+    bool replaceVariablesInFile(const std::string& file_path, const varmatch::Matcher& matcher);
+    bool replaceVariablesInFile(const std::string& source_path, const std::string& destination_path, const varmatch::Matcher& matcher);
+    bool replaceVariablesInFile(const std::string& file_path, 
                                 const std::unordered_map<std::string, std::string>& keyval, 
                                 const std::string& prefix, const std::string& suffix);
 
-    void replaceVariablesInAllFiles(const std::string& root_path, const std::set<std::string>& paths,
+    int forEachFile(const std::string& root_path, const pathtable::PathTable& paths, unsigned int thread_count,
+                    const std::function<bool(const std::string&, const std::string&)>& function);
+    int replaceVariablesInAllFiles(const std::string& root_path, const pathtable::PathTable& paths, const varmatch::Matcher& matcher,
+                                   unsigned int thread_count = 0);
+    int replaceVariablesInAllFiles(const std::string& root_path, const pathtable::PathTable& paths,
                                 const std::unordered_map<std::string, std::string>& keyval, 
                                 const std::string& prefix, const std::string& suffix);
 
-    void replaceVariablesInAllFilenames(const std::string& root_path, const std::set<std::string>& paths,
+    LinkMode materializeFile(const std::string& source_path, const std::string& destination_path, LinkMode link_mode);
+    pathtable::PathTable copyBatchedFiles(const std::string& source_root_path, const pathtable::PathTable& paths, const std::string& destination_root_path,
+                                          const pathtable::PathTable& included_files, const std::unordered_map<std::string, LinkMode>& link_modes);
+    void makeDirectoryTree(const std::string& source_root_path, const pathtable::PathTable& paths, const std::string& destination_root_path);
+    void copyTemplateFiles(const std::string& source_root_path, const pathtable::PathTable& paths, const std::string& destination_root_path,
+                           const std::unordered_map<std::string, LinkMode>& link_modes, unsigned int thread_count = 0);
+    int copyTemplateFiles(const std::string& source_root_path, const pathtable::PathTable& paths, const std::string& destination_root_path,
+                          const pathtable::PathTable& included_files, SubstitutionPlan& plan,
+                          const std::unordered_map<std::string, LinkMode>& link_modes, unsigned int thread_count = 0);
+    std::unordered_map<std::string, LinkMode> getLinkModes(const pathtable::PathTable& paths, const nlohmann::json& link_paths, LinkMode default_mode);
+    std::string renamedPath(const std::string& path, const pathtable::PathTable& included_filenames, const varmatch::Matcher& matcher);
+    void writeLinkManifest(const std::string& manifest_file, const std::string& source_root_path, const std::string& destination_root_path,
+                           const std::unordered_map<std::string, LinkMode>& link_modes, const pathtable::PathTable& included_filenames,
+                           const varmatch::Matcher& matcher);
+
+    void replaceVariablesInAllFilenames(const std::string& root_path, const pathtable::PathTable& paths, const varmatch::Matcher& matcher);
+    void replaceVariablesInAllFilenames(const std::string& root_path, const pathtable::PathTable& paths,
                                 const std::unordered_map<std::string, std::string>& keyval,
                                 const std::string& prefix, const std::string& suffix);
 
-    std::set<std::string> getPaths(const std::string& path, const std::string& relative_to = "");
+    std::set<std::string> getPaths(const std::string& path, const std::string& relative_to = "", unsigned int thread_count = 1);
+    pathtable::PathTable getPathTable(const std::string& path, unsigned int thread_count = 1);
+    pathtable::PathTable getMatchingPaths(const std::string& path, const PathFilter& filter, unsigned int thread_count = 1);
     std::pair<std::set<std::string>, std::unordered_set<std::string>> splitPatterns(const std::set<std::string>& patterns, const std::string& pattern_chars);
 
     std::set<std::string> matchPaths(const std::set<std::string>& included_paths, const std::set<std::string>& pattern_includes,
@@ -86,6 +184,8 @@ namespace helper {
     std::set<std::string> matchPaths(const std::set<std::string>& included_paths, const std::pair<std::set<std::string>, std::unordered_set<std::string>>& pattern_includes,
                                      const std::pair<std::set<std::string>, std::unordered_set<std::string>>& pattern_excludes);
     std::set<std::string> matchPaths(const std::set<std::string>& paths, const std::set<std::string>& include, const std::set<std::string>& exclude);
-    void makeCacheForSearchPaths(const std::string& container_path, const nlohmann::json& search_paths, const std::set<std::string>& included_files,
-                                 const std::set<std::string>& included_filenames);
+    std::set<std::string> matchPaths(const std::set<std::string>& paths, const PathFilter& filter);
+    pathtable::PathTable matchPaths(const pathtable::PathTable& paths, const PathFilter& filter);
+    void makeCacheForSearchPaths(const std::string& container_path, const nlohmann::json& search_paths, const pathtable::PathTable& included_files,
+                                 const pathtable::PathTable& included_filenames);
 }
\ No newline at end of file
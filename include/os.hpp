@@ -1,19 +1,47 @@
 #pragma once
 
+#include "parallel.hpp"
 #include <iostream>
 #include <string>
 #include <vector>
 #include <fstream>
 #include <filesystem>
 #include <set>
+#include <map>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <utility>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #if defined(_WIN32)
     #include <windows.h>
 #elif defined(__linux__)
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/ioctl.h>
+    #include <sys/mman.h>
+    #include <sys/sendfile.h>
     #include <sys/stat.h>
+    #include <sys/syscall.h>
     #include <sys/types.h>
     #include <sys/wait.h>
     #include <cstdlib>
+    #include <dirent.h>
+    #include <linux/fs.h>
+    #if !defined(FICLONE)
+        #define FICLONE _IOW(0x94, 9, int)
+    #endif
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #if defined(__NR_io_uring_setup)
+            #define OS_HAS_IO_URING
+        #endif
+    #endif
 #elif defined(__APPLE__)
     #include <mach-o/dyld.h>
     #include <cstdlib>
@@ -26,10 +54,41 @@ namespace os {
         enum class CopyOption {None, SkipExisting, OverwriteExisting, OverwriteAll};
         enum class TraversalOption {NonRecursive, Recursive};
         enum class SizeMetric {Byte, Kilobyte, Megabyte, Gigabyte};
+        enum class CopyMethod {Stream, ReadWrite, SendFile, CopyFileRange, Reflink, Sparse}; // How the bytes of a file were copied
+        enum class ReflinkOption {Auto, Always, Never}; // When files are cloned instead of copied
+        enum class IoBackend {Threads, IoUring}; // How the files of a directory or a path set are copied
 
         namespace _private { // forward declaration
             std::string errorMessage(const std::string& function_name, const std::string& message);
             char copyWarning(const std::filesystem::path& path);
+            bool copyFile(const std::filesystem::path& from, const std::filesystem::path& to, CopyMethod* method = nullptr);
+
+            // Used by every file copy. Set it before copying from several threads.
+            inline ReflinkOption reflink_option = ReflinkOption::Auto;
+
+            // Number of threads that copy or remove files. (0 to use every hardware thread)
+            inline unsigned int copy_thread_count = 0;
+
+            // Used when copying the files of a directory or a path set
+            inline IoBackend io_backend = IoBackend::Threads;
+
+            // Number of operations kept in flight by the io_uring backend
+            inline unsigned int io_queue_depth = 64;
+
+            // Copies of at least this many bytes have their blocks allocated up front. (0 to never allocate them)
+            inline std::uintmax_t preallocate_size = 64 * 1024 * 1024;
+
+            void copyFiles(const std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& files);
+            void removeAll(const std::filesystem::path& path);
+
+            template<typename Function>
+            bool runDetached(Function function);
+
+            template<typename Function, typename Descend>
+            void walkDirectory(const std::filesystem::path& directory, Function& function, Descend& descend);
+
+            template<typename Function, typename Descend>
+            void walkDirectoryParallel(const std::filesystem::path& directory, unsigned int thread_count, Function& function, Descend& descend);
 
             bool copy(const std::filesystem::path& source, const std::filesystem::path& destination, 
                       const CopyOption& op, const TraversalOption& t_op);
@@ -391,6 +450,175 @@ namespace os {
             return _private::copy(from, paths_to_copy_in_from, to, op);
         }
 
+        /*
+            Sets when files are cloned instead of copied.
+            A clone (reflink) shares the data blocks of the source until either file is changed, so it takes
+            no extra disk space and almost no time. Only some filesystems support it, such as btrfs and XFS.
+
+            Parameters:
+            `option`: `Auto` clones where supported and copies elsewhere, `Always` throws if a file cannot be cloned
+                      and `Never` always copies.
+        */
+        inline void setReflinkOption(ReflinkOption option)
+        {
+            _private::reflink_option = option;
+        }
+
+        inline ReflinkOption getReflinkOption()
+        {
+            return _private::reflink_option;
+        }
+
+        /*
+            Sets the number of threads that copy the files of a directory or a path set, or remove a directory tree.
+
+            Parameters:
+            `thread_count`: Number of threads. (0 to use every hardware thread)
+        */
+        inline void setCopyThreadCount(unsigned int thread_count)
+        {
+            _private::copy_thread_count = thread_count;
+        }
+
+        /*
+            Sets how the files of a directory or a path set are copied. `Threads` copies them over a pool of threads.
+            `IoUring` keeps the opens, reads, writes and closes of many files in flight from a single thread, which helps
+            when every syscall waits on slow storage such as network block devices. It needs io_uring (Linux 5.6 and later)
+            and falls back to `Threads` where it is not available.
+
+            Parameters:
+            `backend`: Backend to use.
+            `queue_depth`: Number of operations the io_uring backend keeps in flight.
+        */
+        inline void setIoBackend(IoBackend backend, unsigned int queue_depth = 64)
+        {
+            _private::io_backend = backend;
+            _private::io_queue_depth = queue_depth > 0 ? queue_depth : 1;
+        }
+
+        inline IoBackend getIoBackend()
+        {
+            return _private::io_backend;
+        }
+
+        /*
+            Sets the size from which the blocks of a copied file are allocated before its bytes are written, so large
+            files are not fragmented as they grow. Only used on Linux and never for sparse files.
+
+            Parameters:
+            `size`: Size in bytes. (0 to never allocate them up front)
+        */
+        inline void setPreallocateSize(std::uintmax_t size)
+        {
+            _private::preallocate_size = size;
+        }
+
+        inline std::uintmax_t getPreallocateSize()
+        {
+            return _private::preallocate_size;
+        }
+
+        /*
+            Copies a single file, overwriting the destination. The parent directory of the destination is created if needed.
+            On Linux the file is first cloned with `ioctl(FICLONE)` as set by `setReflinkOption()`. Otherwise the bytes are
+            copied in the kernel with `copy_file_range()`, falling back to `sendfile()` and then to a read/write loop.
+            Sparse files only have their data copied so their holes stay holes. Elsewhere the file is copied through streams.
+
+            Parameters:
+            `from`: File to copy.
+            `to`: Path of the copy.
+            `method`: Set to how the bytes were copied. (Optional)
+            `make_parent`: Whether to make the parent directory of `to` if it does not exist. Turn it off when the
+                           directories were made beforehand, such as from `directoryPlan()`.
+        */
+        inline bool copyFile(const std::filesystem::path& from, const std::filesystem::path& to, CopyMethod* method = nullptr,
+                             bool make_parent = true)
+        {
+            std::filesystem::path parent = to.parent_path();
+            if(make_parent && !parent.empty() && !std::filesystem::exists(parent)) {
+                std::filesystem::create_directories(parent);
+            }
+
+            return _private::copyFile(from, to, method);
+        }
+
+        /*
+            Returns the given directories and all of their parents, each only once. Parents come before their children,
+            so the directories can be made one by one in order without checking for their parents.
+
+            Parameters:
+            `directories`: Relative paths of the directories that are needed. Empty paths are ignored.
+        */
+        inline std::set<std::filesystem::path> directoryPlan(const std::vector<std::filesystem::path>& directories)
+        {
+            // Paths are compared by their elements, so a parent always sorts before its children
+            std::set<std::filesystem::path> plan;
+            for(const auto& i : directories) {
+                std::filesystem::path directory = i.lexically_normal();
+                if(!directory.has_filename()) {
+                    directory = directory.parent_path();
+                }
+
+                while(!directory.empty() && directory != "." && plan.insert(directory).second) {
+                    directory = directory.parent_path();
+                }
+            }
+
+            return plan;
+        }
+
+        /*
+            Calls a function for every entry under a directory with its path relative to the directory. Directories come
+            before their contents and symbolic links are not followed. On Linux the entries are read in large batches with
+            `getdents64()` and their type is taken from the entry, so they are not stat'ed. Subdirectories rejected by
+            `descend` are still passed to `function`, but their contents are skipped.
+
+            Parameters:
+            `directory`: Directory to walk.
+            `function`: Called with the relative path of each entry and whether it is a directory.
+            `descend`: Called with the relative path of each subdirectory. Returns whether to walk it. (Optional)
+        */
+        template<typename Function, typename Descend>
+        void walkDirectory(const std::filesystem::path& directory, Function function, Descend descend)
+        {
+            _private::walkDirectory(directory, function, descend);
+        }
+
+        template<typename Function>
+        void walkDirectory(const std::filesystem::path& directory, Function function)
+        {
+            walkDirectory(directory, function, [](const std::string&) {
+                return true;
+            });
+        }
+
+        /*
+            Like `walkDirectory()`, but directories are read by several threads at once, which helps when every read waits
+            on slow storage such as a network filesystem. Each thread takes the directories it found itself first and
+            steals the oldest directories of other threads when it runs out. The function is called from every thread
+            and is given the index of the calling thread, so it can keep its results per thread without locking.
+            Directories still come before their contents. Elsewhere than on Linux the walk uses a single thread.
+
+            Parameters:
+            `directory`: Directory to walk.
+            `thread_count`: Number of threads. (0 to use every hardware thread)
+            `function`: Called with the index of the thread, the relative path of each entry and whether it is a directory.
+            `descend`: Called with the relative path of each subdirectory. Returns whether to walk it. (Optional)
+        */
+        template<typename Function, typename Descend>
+        void walkDirectoryParallel(const std::filesystem::path& directory, unsigned int thread_count, Function function, Descend descend)
+        {
+            _private::walkDirectoryParallel(directory, thread_count, function, descend);
+        }
+
+        template<typename Function>
+        void walkDirectoryParallel(const std::filesystem::path& directory, unsigned int thread_count, Function function)
+        {
+            walkDirectoryParallel(directory, thread_count, function, [](const std::string&) {
+                return true;
+            });
+        }
+
         inline bool move(const std::filesystem::path& from, const std::filesystem::path& to, const TraversalOption& traversal_option,
                         const CopyOption& copy_option = CopyOption::None)
         {
@@ -422,10 +650,10 @@ namespace os {
             if(std::filesystem::is_directory(path)) {
                 if(isDirectoryString(path)) {
                     for(const auto& entry : std::filesystem::directory_iterator(path)) {
-                        std::filesystem::remove_all(entry.path());
+                        _private::removeAll(entry.path());
                     }
                 } else {
-                    std::filesystem::remove_all(path);
+                    _private::removeAll(path);
                 }
             } else {
                 std::filesystem::remove(path);
@@ -434,6 +662,212 @@ namespace os {
             return true;
         }
 
+        /*
+            Removes a path without waiting for it. On Linux the removal runs in a detached process, so it goes on
+            after this process exits. Elsewhere, or if no process can be started, the path is removed before returning.
+
+            Parameters:
+            `path`: Path to remove.
+        */
+        inline void removeInBackground(const std::filesystem::path& path)
+        {
+            auto removePath = [path]() {
+                try {
+                    _private::removeAll(path);
+                } catch(...) {}
+            };
+
+            if(!_private::runDetached(removePath)) {
+                removePath();
+            }
+        }
+
+        /*
+            Moves a path into a trash directory so it can be removed later, without waiting for its contents to be removed.
+            The trash directory is made if needed and should be on the same filesystem as the path.
+            Returns the path in the trash, or an empty path if it could not be moved, such as across filesystems.
+
+            Parameters:
+            `path`: Path to move.
+            `trash_directory`: Directory to move the path into.
+        */
+        inline std::filesystem::path moveToTrash(const std::filesystem::path& path, const std::filesystem::path& trash_directory)
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(trash_directory, ec);
+            if(ec) {
+                return {};
+            }
+
+            std::string name = (path.filename().empty() ? path.parent_path().filename() : path.filename()).string();
+            #if defined(__linux__)
+                name += "." + std::to_string(::getpid());
+            #endif
+
+            for(int i = 0; i < 100; i++) {
+                std::filesystem::path trashed = trash_directory / (name + "-" + std::to_string(i));
+                #if defined(__linux__) && defined(SYS_renameat2)
+                    if(::syscall(SYS_renameat2, AT_FDCWD, path.c_str(), AT_FDCWD, trashed.c_str(), RENAME_NOREPLACE) == 0) {
+                        return trashed;
+                    }
+
+                    if(errno != EEXIST) {
+                        return {};
+                    }
+                #else
+                    if(std::filesystem::exists(trashed, ec)) {
+                        continue;
+                    }
+
+                    std::filesystem::rename(path, trashed, ec);
+                    return ec ? std::filesystem::path() : trashed;
+                #endif
+            }
+
+            return {};
+        }
+
+        /*
+            Removes everything in a trash directory made by `moveToTrash()`, leaving the directory itself.
+            Returns the number of entries that were removed.
+
+            Parameters:
+            `trash_directory`: Trash directory to empty.
+        */
+        inline std::size_t emptyTrash(const std::filesystem::path& trash_directory)
+        {
+            std::error_code ec;
+            if(!std::filesystem::is_directory(trash_directory, ec)) {
+                return 0;
+            }
+
+            std::vector<std::filesystem::path> entries;
+            for(const auto& entry : std::filesystem::directory_iterator(trash_directory)) {
+                entries.push_back(entry.path());
+            }
+
+            for(const auto& i : entries) {
+                _private::removeAll(i);
+            }
+
+            return entries.size();
+        }
+
+        /*
+            Empties a trash directory without waiting for it, like `removeInBackground()`.
+            Whatever is left, such as after the machine shuts down, is removed by the next `emptyTrash()`.
+
+            Parameters:
+            `trash_directory`: Trash directory to empty.
+        */
+        inline void emptyTrashInBackground(const std::filesystem::path& trash_directory)
+        {
+            auto empty = [trash_directory]() {
+                try {
+                    path::emptyTrash(trash_directory);
+                } catch(...) {}
+            };
+
+            if(!_private::runDetached(empty)) {
+                empty();
+            }
+        }
+
+        /*
+            Makes an empty directory next to `destination` to build its new contents in before calling `replaceDirectory()`.
+            Returns an empty path if the contents should be replaced in place instead, which is when `destination` does not
+            exist or is empty, is a symbolic link, holds the current directory (swapping it would leave shells inside it in
+            a removed directory), is a mount point (the staging directory would be on another filesystem), cannot be
+            swapped on this platform or when the directory cannot be made.
+
+            Parameters:
+            `destination`: Directory whose contents are replaced.
+        */
+        inline std::filesystem::path makeStagingDirectory(const std::filesystem::path& destination)
+        {
+            #if defined(__linux__)
+                std::error_code ec;
+                if(std::filesystem::is_symlink(destination, ec) || !std::filesystem::is_directory(destination, ec) ||
+                   std::filesystem::is_empty(destination, ec) || ec) {
+                    return {};
+                }
+
+                std::filesystem::path target = std::filesystem::canonical(destination, ec);
+                std::filesystem::path current = std::filesystem::current_path(ec);
+                if(ec || std::mismatch(target.begin(), target.end(), current.begin(), current.end()).first == target.end()) {
+                    return {};
+                }
+
+                struct stat target_info;
+                struct stat parent_info;
+                if(::stat(target.c_str(), &target_info) != 0 || ::stat(target.parent_path().c_str(), &parent_info) != 0 ||
+                   target_info.st_dev != parent_info.st_dev) {
+                    return {};
+                }
+
+                for(int i = 0; i < 100; i++) {
+                    std::string name = "." + target.filename().string() + ".staging-" + std::to_string(::getpid()) + "-" + std::to_string(i);
+                    std::filesystem::path staging = target.parent_path() / name;
+                    if(std::filesystem::create_directory(staging, ec)) {
+                        std::filesystem::permissions(staging, std::filesystem::status(target, ec).permissions(), ec);
+                        return staging;
+                    }
+
+                    if(ec) {
+                        return {};
+                    }
+                }
+            #endif
+
+            return {};
+        }
+
+        /*
+            Puts a directory made by `makeStagingDirectory()` in place of `destination`. On Linux the two are swapped
+            atomically with `renameat2(RENAME_EXCHANGE)`, so `destination` always holds either the whole old tree or the
+            whole new one, even if the process is killed, and the old tree is then removed in the background.
+            Elsewhere, or if they cannot be swapped, the contents of `destination` are removed and the staged entries
+            are moved into it, or copied if they are on another filesystem.
+
+            Parameters:
+            `staging`: Directory holding the new contents.
+            `destination`: Directory whose contents are replaced.
+            `trash_directory`: Trash to move the old tree into before removing it, so `emptyTrash()` can finish
+                               the removal if it is interrupted. (Optional)
+        */
+        inline void replaceDirectory(const std::filesystem::path& staging, const std::filesystem::path& destination,
+                                     const std::filesystem::path& trash_directory = {})
+        {
+            #if defined(__linux__) && defined(SYS_renameat2)
+                std::error_code ec;
+                std::filesystem::path target = std::filesystem::canonical(destination, ec);
+                if(!ec && ::syscall(SYS_renameat2, AT_FDCWD, staging.c_str(), AT_FDCWD, target.c_str(), RENAME_EXCHANGE) == 0) {
+                    if(!trash_directory.empty() && !path::moveToTrash(staging, trash_directory).empty()) {
+                        emptyTrashInBackground(trash_directory);
+                    } else {
+                        removeInBackground(staging);
+                    }
+                    return;
+                }
+            #endif
+
+            for(const auto& entry : std::filesystem::directory_iterator(destination)) {
+                path::remove(entry.path());
+            }
+
+            for(const auto& entry : std::filesystem::directory_iterator(staging)) {
+                std::error_code ec;
+                std::filesystem::path to = destination / entry.path().filename();
+                std::filesystem::rename(entry.path(), to, ec);
+                if(ec == std::errc::cross_device_link) {
+                    std::filesystem::copy(entry.path(), to, std::filesystem::copy_options::recursive | std::filesystem::copy_options::copy_symlinks);
+                } else if(ec) {
+                    throw std::filesystem::filesystem_error("rename", entry.path(), to, ec);
+                }
+            }
+            path::remove(staging);
+        }
+
         inline bool hasSameContent(const std::filesystem::path& p1, const std::filesystem::path& p2)
         {
             if(!std::filesystem::exists(p1)) {
@@ -559,38 +993,1285 @@ namespace os {
                 return ch; 
             }
 
-            inline bool copyFile(const std::filesystem::path& from, const std::filesystem::path& to) 
-            {
-                std::filesystem::path parent_temp = to.parent_path();
-                if(!parent_temp.empty() && !std::filesystem::exists(parent_temp)) {
-                    std::filesystem::create_directories(parent_temp);
+            #if defined(__linux__)
+                /*
+                    Copies `in` to `out` from their current offsets. The first `size` bytes are copied in the kernel
+                    with `copy_file_range()`, or with `sendfile()` where that is not supported (e.g. across filesystems
+                    on older kernels). Anything left, including files that report a size of 0 such as those in `/proc`,
+                    is copied with a read/write loop.
+
+                    Parameters:
+                    `in`: File descriptor to read from.
+                    `out`: File descriptor to write to.
+                    `size`: Expected number of bytes.
+                    `method`: Set to the fastest method that copied any bytes.
+                */
+                inline bool copyFileDescriptor(int in, int out, std::uintmax_t size, CopyMethod& method)
+                {
+                    std::uintmax_t copied = 0;
+                    method = CopyMethod::ReadWrite;
+
+                    while(copied < size) {
+                        ssize_t count = ::copy_file_range(in, nullptr, out, nullptr, size - copied, 0);
+                        if(count < 0 && errno == EINTR) {
+                            continue;
+                        }
+
+                        if(count <= 0) {
+                            break;
+                        }
+
+                        copied += count;
+                        method = CopyMethod::CopyFileRange;
+                    }
+
+                    while(copied < size) {
+                        ssize_t count = ::sendfile(out, in, nullptr, size - copied);
+                        if(count < 0 && errno == EINTR) {
+                            continue;
+                        }
+
+                        if(count <= 0) {
+                            break;
+                        }
+
+                        copied += count;
+                        if(method == CopyMethod::ReadWrite) {
+                            method = CopyMethod::SendFile;
+                        }
+                    }
+
+                    static thread_local std::vector<char> buffer(1024 * 1024);
+                    while(true) {
+                        ssize_t count = ::read(in, buffer.data(), buffer.size());
+                        if(count < 0 && errno == EINTR) {
+                            continue;
+                        }
+
+                        if(count < 0) {
+                            return false;
+                        }
+
+                        if(count == 0) {
+                            return true;
+                        }
+
+                        for(ssize_t written = 0; written < count;) {
+                            ssize_t n = ::write(out, buffer.data() + written, count - written);
+                            if(n < 0 && errno == EINTR) {
+                                continue;
+                            }
+
+                            if(n <= 0) {
+                                return false;
+                            }
+
+                            written += n;
+                        }
+                    }
                 }
 
-                std::ifstream source(from, std::ios::binary);
-                if(!source.is_open()) {
-                    return false;
+                // Whether a file takes up less space than its size, meaning it has holes that a plain copy would fill with zeros
+                inline bool isSparse(const struct stat& info)
+                {
+                    return S_ISREG(info.st_mode) && info.st_blocks * 512 < info.st_size;
                 }
 
-                std::ofstream destination(to, std::ios::binary);
-                if(!destination.is_open()) {
-                    source.close();
-                    return false;
+                /*
+                    Copies only the data of a sparse file, found with `lseek(SEEK_DATA)` and `lseek(SEEK_HOLE)`, so its holes
+                    are kept in the copy. Both offsets are left at the start of the files. Returns false if the filesystem
+                    cannot report the holes or a copy fails, in which case the file should be copied as a whole.
+
+                    Parameters:
+                    `in`: File descriptor to read from.
+                    `out`: Empty file descriptor to write to.
+                    `size`: Size of the file.
+                */
+                inline bool copySparseFileDescriptor(int in, int out, off_t size)
+                {
+                    static thread_local std::vector<char> buffer(1024 * 1024);
+                    auto copyRange = [&](off_t begin, off_t end) {
+                        while(begin < end) {
+                            loff_t in_offset = begin;
+                            loff_t out_offset = begin;
+                            ssize_t count = ::copy_file_range(in, &in_offset, out, &out_offset, end - begin, 0);
+                            if(count < 0 && errno == EINTR) {
+                                continue;
+                            }
+
+                            if(count <= 0) {
+                                count = ::pread(in, buffer.data(), std::min<off_t>(buffer.size(), end - begin), begin);
+                                if(count < 0 && errno == EINTR) {
+                                    continue;
+                                }
+
+                                if(count <= 0) {
+                                    return false;
+                                }
+
+                                for(ssize_t written = 0; written < count;) {
+                                    ssize_t n = ::pwrite(out, buffer.data() + written, count - written, begin + written);
+                                    if(n < 0 && errno == EINTR) {
+                                        continue;
+                                    }
+
+                                    if(n <= 0) {
+                                        return false;
+                                    }
+
+                                    written += n;
+                                }
+                            }
+
+                            begin += count;
+                        }
+
+                        return true;
+                    };
+
+                    bool result = true;
+                    for(off_t data = ::lseek(in, 0, SEEK_DATA); data < size;) {
+                        if(data < 0) {
+                            result = errno == ENXIO; // no data left
+                            break;
+                        }
+
+                        off_t hole = ::lseek(in, data, SEEK_HOLE);
+                        if(hole < 0 || hole > size) {
+                            hole = size;
+                        }
+
+                        if(!copyRange(data, hole)) {
+                            result = false;
+                            break;
+                        }
+
+                        data = hole < size ? ::lseek(in, hole, SEEK_DATA) : size;
+                    }
+
+                    ::lseek(in, 0, SEEK_SET);
+                    return result && ::ftruncate(out, size) == 0;
+                }
+
+                /*
+                    Copies the bytes of a file that could not be cloned. Sparse files only have their data copied, and files
+                    of at least `preallocate_size` bytes have their blocks allocated before they are written.
+
+                    Parameters:
+                    `in`: File descriptor to read from, at its start.
+                    `out`: Empty file descriptor to write to.
+                    `info`: Status of `in`.
+                    `method`: Set to how the bytes were copied.
+                */
+                inline bool copyFileData(int in, int out, const struct stat& info, CopyMethod& method)
+                {
+                    if(isSparse(info)) {
+                        if(copySparseFileDescriptor(in, out, info.st_size)) {
+                            method = CopyMethod::Sparse;
+                            return true;
+                        }
+
+                        if(::ftruncate(out, 0) != 0) {
+                            return false;
+                        }
+                    } else if(preallocate_size > 0 && static_cast<std::uintmax_t>(info.st_size) >= preallocate_size) {
+                        // Keep the size so a file that shrinks while it is copied is not padded with zeros
+                        ::fallocate(out, FALLOC_FL_KEEP_SIZE, 0, info.st_size);
+                    }
+
+                    return copyFileDescriptor(in, out, info.st_size, method);
+                }
+
+                /*
+                    Copies a file relative to open directories. Regular files are cloned where the filesystem supports it,
+                    otherwise their bytes are copied with `copyFileData()`.
+
+                    Parameters:
+                    `from_directory`: Directory `from` is relative to. (`AT_FDCWD` for the working directory)
+                    `from`: File to copy.
+                    `to_directory`: Directory `to` is relative to. (`AT_FDCWD` for the working directory)
+                    `to`: File to create or overwrite.
+                    `method`: Set to how the bytes of the file were copied.
+                */
+                inline bool copyFileAt(int from_directory, const char* from, int to_directory, const char* to, CopyMethod* method = nullptr)
+                {
+                    int source = ::openat(from_directory, from, O_RDONLY | O_CLOEXEC);
+                    if(source < 0) {
+                        return false;
+                    }
+
+                    struct stat info;
+                    if(::fstat(source, &info) != 0) {
+                        ::close(source);
+                        return false;
+                    }
+
+                    int destination = ::openat(to_directory, to, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+                    if(destination < 0) {
+                        ::close(source);
+                        return false;
+                    }
+
+                    // Share the data blocks of the source if the filesystem supports it
+                    if(reflink_option != ReflinkOption::Never && S_ISREG(info.st_mode)) {
+                        if(::ioctl(destination, FICLONE, source) == 0) {
+                            ::close(source);
+                            if(method) {
+                                *method = CopyMethod::Reflink;
+                            }
+                            return ::close(destination) == 0;
+                        }
+
+                        if(reflink_option == ReflinkOption::Always) {
+                            ::close(source);
+                            ::close(destination);
+                            throw std::runtime_error(_private::errorMessage(__func__, std::string("\"") + from + "\" could not be cloned"));
+                        }
+                    }
+
+                    CopyMethod used;
+                    bool result = copyFileData(source, destination, info, used);
+                    ::close(source);
+                    if(::close(destination) != 0) {
+                        result = false;
+                    }
+
+                    if(method) {
+                        *method = used;
+                    }
+
+                    return result;
                 }
 
-                destination << source.rdbuf(); 
+                // Closes a file descriptor when it goes out of scope
+                class FileDescriptor {
+                    private:
+                        int fd_;
+
+                    public:
+                        explicit FileDescriptor(int fd = -1) : fd_(fd) {}
+                        FileDescriptor(const FileDescriptor&) = delete;
+                        FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+                        ~FileDescriptor()
+                        {
+                            if(fd_ >= 0) {
+                                ::close(fd_);
+                            }
+                        }
+
+                        int get() const
+                        {
+                            return fd_;
+                        }
+                };
+            #endif
+
+            // Copies a file into an existing directory. Use `path::copyFile()` to make the parent directory first.
+            inline bool copyFile(const std::filesystem::path& from, const std::filesystem::path& to, CopyMethod* method) 
+            {
+                #if defined(__linux__)
+                    return copyFileAt(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), method);
+                #else
+                    if(_private::reflink_option == ReflinkOption::Always) {
+                        throw std::runtime_error(_private::errorMessage(__func__, "\"" + from.string() + "\" could not be cloned"));
+                    }
+
+                    if(method) {
+                        *method = CopyMethod::Stream;
+                    }
+
+                    std::ifstream source(from, std::ios::binary);
+                    if(!source.is_open()) {
+                        return false;
+                    }
+
+                    std::ofstream destination(to, std::ios::binary);
+                    if(!destination.is_open()) {
+                        source.close();
+                        return false;
+                    }
+
+                    destination << source.rdbuf(); 
+
+                    if(!destination) {
+                        source.close();
+                        destination.close();
+                        return false;
+                    }
 
-                if(!destination) {
                     source.close();
                     destination.close();
-                    return false;
+
+                    return true;
+                #endif
+            }
+
+            /*
+                Copies files over a pool of threads. The parent directories of the destinations are made first,
+                once each and in order, so the threads only copy bytes. If copies throw, the error of the first file is rethrown.
+
+                Parameters:
+                `files`: Source and destination of each file.
+            */
+            inline void copyFiles(const std::vector<std::pair<std::filesystem::path, std::filesystem::path>>& files)
+            {
+                std::vector<std::filesystem::path> parents;
+                for(const auto& i : files) {
+                    parents.push_back(i.second.parent_path());
                 }
 
-                source.close();
-                destination.close();
+                for(const auto& i : path::directoryPlan(parents)) {
+                    std::filesystem::create_directory(i);
+                }
 
-                return true;
+                parallel::forEach(files.size(), copy_thread_count, [&](std::size_t i) {
+                    copyFile(files[i].first, files[i].second);
+                });
+            }
+
+            template<typename Function>
+            bool runDetached(Function function)
+            {
+                #if defined(__linux__)
+                    // Fork twice so the process that runs the function is not left as a zombie of this one
+                    pid_t child = ::fork();
+                    if(child == 0) {
+                        if(::fork() == 0) {
+                            // Leave the session and the standard streams of the caller, so a pipe reading its output
+                            // or a terminal closing does not wait on or stop the function
+                            ::setsid();
+                            int null = ::open("/dev/null", O_RDWR | O_CLOEXEC);
+                            if(null >= 0) {
+                                for(int fd = 0; fd < 3; fd++) {
+                                    ::dup2(null, fd);
+                                }
+                                if(null > 2) {
+                                    ::close(null);
+                                }
+                            }
+                            function();
+                        }
+                        ::_exit(0);
+                    }
+
+                    if(child > 0) {
+                        ::waitpid(child, nullptr, 0);
+                        return true;
+                    }
+                #endif
+
+                return false;
+            }
+
+            #if defined(__linux__)
+                /*
+                    Unlinks everything but the directories inside a directory and returns its subdirectories.
+
+                    Parameters:
+                    `root`: Directory `directory` is relative to.
+                    `directory`: Directory to empty of files.
+                */
+                inline std::vector<std::string> removeFilesAt(int root, const std::string& directory)
+                {
+                    std::vector<std::string> subdirectories;
+                    int fd = ::openat(root, directory.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    DIR* dir = fd >= 0 ? ::fdopendir(fd) : nullptr;
+                    if(!dir) {
+                        if(fd >= 0) {
+                            ::close(fd);
+                        }
+                        return subdirectories;
+                    }
+
+                    while(dirent* entry = ::readdir(dir)) {
+                        std::string name = entry->d_name;
+                        if(name == "." || name == "..") {
+                            continue;
+                        }
+
+                        bool is_directory = entry->d_type == DT_DIR;
+                        if(entry->d_type == DT_UNKNOWN) {
+                            struct stat info;
+                            is_directory = ::fstatat(::dirfd(dir), name.c_str(), &info, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(info.st_mode);
+                        }
+
+                        if(is_directory) {
+                            subdirectories.push_back(directory == "." ? name : directory + "/" + name);
+                        } else {
+                            ::unlinkat(::dirfd(dir), name.c_str(), 0);
+                        }
+                    }
+
+                    ::closedir(dir);
+                    return subdirectories;
+                }
+            #endif
+
+            /*
+                Removes a path and everything in it like `std::filesystem::remove_all()`. On Linux the files are unlinked
+                over the worker pool a level of directories at a time with `unlinkat()` relative to the open root, and
+                the directories are then removed deepest first. Symbolic links are removed, not followed. A path that
+                is already gone is not an error, so several processes can remove the same tree.
+
+                Parameters:
+                `path`: Path to remove.
+            */
+            inline void removeAll(const std::filesystem::path& path)
+            {
+                #if defined(__linux__)
+                    struct stat info;
+                    if(::lstat(path.c_str(), &info) != 0) {
+                        return;
+                    }
+
+                    if(!S_ISDIR(info.st_mode)) {
+                        std::filesystem::remove(path);
+                        return;
+                    }
+
+                    {
+                        FileDescriptor root(::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+                        if(root.get() >= 0) {
+                            std::vector<std::vector<std::string>> levels = {{"."}};
+                            while(!levels.back().empty()) {
+                                const std::vector<std::string>& level = levels.back();
+                                std::vector<std::vector<std::string>> found(level.size());
+                                parallel::forEach(level.size(), copy_thread_count, [&](std::size_t i) {
+                                    found[i] = removeFilesAt(root.get(), level[i]);
+                                });
+
+                                std::vector<std::string> next;
+                                for(auto& i : found) {
+                                    next.insert(next.end(), std::make_move_iterator(i.begin()), std::make_move_iterator(i.end()));
+                                }
+                                levels.push_back(std::move(next));
+                            }
+
+                            // Every level of subdirectories is emptied by the level below it
+                            for(std::size_t i = levels.size() - 1; i > 1; i--) {
+                                const std::vector<std::string>& level = levels[i - 1];
+                                parallel::forEach(level.size(), copy_thread_count, [&](std::size_t j) {
+                                    ::unlinkat(root.get(), level[j].c_str(), AT_REMOVEDIR);
+                                });
+                            }
+                        }
+                    }
+                #endif
+
+                std::filesystem::remove_all(path);
             }
 
+            #if defined(__linux__)
+                // Entry returned by `getdents64()`
+                struct LinuxDirent64 {
+                    ino64_t d_ino;
+                    off64_t d_off;
+                    unsigned short d_reclen;
+                    unsigned char d_type;
+                    char d_name[1];
+                };
+
+                /*
+                    Reads a directory with `getdents64()` and calls a function for each of its entries. Entries whose type
+                    the filesystem does not report are stat'ed.
+
+                    Parameters:
+                    `root`: Directory `directory` is relative to.
+                    `directory`: Path of the directory relative to `root`. (Empty for `root` itself)
+                    `buffer`: Buffer the entries are read into.
+                    `function`: Called with the relative path of each entry and whether it is a directory.
+                    `descend`: Called with the relative path of each subdirectory. Returns whether to walk it.
+                    `subdirectories`: Paths of the subdirectories to walk are added to it.
+                */
+                template<typename Function, typename Descend>
+                void readDirectoryAt(int root, const std::string& directory, std::vector<char>& buffer, Function& function,
+                                     Descend& descend, std::vector<std::string>& subdirectories)
+                {
+                    FileDescriptor fd(::openat(root, directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+                    if(fd.get() < 0) {
+                        throw std::runtime_error(_private::errorMessage(__func__, "\"" + directory + "\" could not be opened: " + std::strerror(errno)));
+                    }
+
+                    // Paths are built on a running prefix so only the name of each entry is appended
+                    std::string path = directory;
+                    if(!path.empty()) {
+                        path.push_back('/');
+                    }
+                    const std::size_t prefix_size = path.size();
+
+                    while(true) {
+                        long count = ::syscall(SYS_getdents64, fd.get(), buffer.data(), buffer.size());
+                        if(count < 0 && errno == EINTR) {
+                            continue;
+                        }
+
+                        if(count < 0) {
+                            throw std::runtime_error(_private::errorMessage(__func__, "\"" + directory + "\" could not be read: " + std::strerror(errno)));
+                        }
+
+                        if(count == 0) {
+                            return;
+                        }
+
+                        for(long offset = 0; offset < count;) {
+                            const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+                            offset += entry->d_reclen;
+
+                            const char* name = entry->d_name;
+                            if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                                continue;
+                            }
+
+                            bool is_directory = entry->d_type == DT_DIR;
+                            if(entry->d_type == DT_UNKNOWN) {
+                                struct stat info;
+                                is_directory = ::fstatat(fd.get(), name, &info, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(info.st_mode);
+                            }
+
+                            path.resize(prefix_size);
+                            path.append(name);
+                            function(static_cast<const std::string&>(path), is_directory);
+                            if(is_directory && descend(static_cast<const std::string&>(path))) {
+                                subdirectories.push_back(path);
+                            }
+                        }
+                    }
+                }
+            #endif
+
+            template<typename Function, typename Descend>
+            void walkDirectory(const std::filesystem::path& directory, Function& function, Descend& descend)
+            {
+                #if defined(__linux__)
+                    FileDescriptor root(::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+                    if(root.get() < 0) {
+                        throw std::runtime_error(_private::errorMessage(__func__, "\"" + directory.string() + "\" could not be opened: " + std::strerror(errno)));
+                    }
+
+                    std::vector<char> buffer(128 * 1024);
+                    std::vector<std::string> pending = {""};
+                    while(!pending.empty()) {
+                        std::string next = std::move(pending.back());
+                        pending.pop_back();
+                        readDirectoryAt(root.get(), next, buffer, function, descend, pending);
+                    }
+                #else
+                    for(auto i = std::filesystem::recursive_directory_iterator(directory); i != std::filesystem::recursive_directory_iterator(); ++i) {
+                        std::string path = normalizePath(i->path().lexically_relative(directory));
+                        bool is_directory = i->symlink_status().type() == std::filesystem::file_type::directory;
+                        function(static_cast<const std::string&>(path), is_directory);
+                        if(is_directory && !descend(static_cast<const std::string&>(path))) {
+                            i.disable_recursion_pending();
+                        }
+                    }
+                #endif
+            }
+
+            // Directories left to read by a worker. The worker takes the newest, other workers steal the oldest.
+            class WorkDeque {
+                private:
+                    std::mutex mutex_;
+                    std::deque<std::string> items_;
+
+                public:
+                    void push(std::string item)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        items_.push_back(std::move(item));
+                    }
+
+                    bool pop(std::string& item)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        if(items_.empty()) {
+                            return false;
+                        }
+
+                        item = std::move(items_.back());
+                        items_.pop_back();
+                        return true;
+                    }
+
+                    bool steal(std::string& item)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        if(items_.empty()) {
+                            return false;
+                        }
+
+                        item = std::move(items_.front());
+                        items_.pop_front();
+                        return true;
+                    }
+            };
+
+            template<typename Function, typename Descend>
+            void walkDirectoryParallel(const std::filesystem::path& directory, unsigned int thread_count, Function& function, Descend& descend)
+            {
+                #if defined(__linux__)
+                    std::size_t threads = parallel::threadCount(thread_count);
+                    if(threads > 1) {
+                        FileDescriptor root(::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+                        if(root.get() < 0) {
+                            throw std::runtime_error(_private::errorMessage(__func__, "\"" + directory.string() + "\" could not be opened: " + std::strerror(errno)));
+                        }
+
+                        std::vector<WorkDeque> deques(threads);
+                        deques[0].push("");
+
+                        // Directories queued or being read. It only drops to 0 once every directory has been read.
+                        std::atomic<std::size_t> pending(1);
+                        std::atomic<std::size_t> queued(1);
+                        std::atomic<bool> failed(false);
+                        std::exception_ptr error;
+                        std::mutex error_mutex;
+
+                        // Workers with nothing to take sleep until a directory is queued or the walk ends
+                        std::atomic<std::size_t> idle(0);
+                        std::mutex idle_mutex;
+                        std::condition_variable wake;
+                        auto wakeIdle = [&]() {
+                            if(idle > 0) {
+                                std::lock_guard<std::mutex> lock(idle_mutex);
+                                wake.notify_all();
+                            }
+                        };
+
+                        auto work = [&](std::size_t worker) {
+                            std::vector<char> buffer(128 * 1024);
+                            std::vector<std::string> found;
+                            std::string next;
+                            auto report = [&](const std::string& path, bool is_directory) {
+                                function(worker, path, is_directory);
+                            };
+
+                            while(pending > 0 && !failed) {
+                                bool taken = deques[worker].pop(next);
+                                for(std::size_t i = 1; !taken && i < threads; i++) {
+                                    taken = deques[(worker + i) % threads].steal(next);
+                                }
+
+                                if(!taken) {
+                                    std::unique_lock<std::mutex> lock(idle_mutex);
+                                    idle++;
+                                    wake.wait(lock, [&]() {
+                                        return queued > 0 || pending == 0 || failed;
+                                    });
+                                    idle--;
+                                    continue;
+                                }
+                                queued--;
+
+                                try {
+                                    found.clear();
+                                    readDirectoryAt(root.get(), next, buffer, report, descend, found);
+                                    pending += found.size();
+                                    queued += found.size();
+                                    for(auto& i : found) {
+                                        deques[worker].push(std::move(i));
+                                    }
+                                    if(!found.empty()) {
+                                        wakeIdle();
+                                    }
+                                } catch(...) {
+                                    {
+                                        std::lock_guard<std::mutex> lock(error_mutex);
+                                        if(!error) {
+                                            error = std::current_exception();
+                                        }
+                                    }
+                                    failed = true;
+                                    wakeIdle();
+                                }
+
+                                if(--pending == 0) {
+                                    wakeIdle();
+                                }
+                            }
+                        };
+
+                        std::vector<std::thread> pool;
+                        pool.reserve(threads - 1);
+                        for(std::size_t i = 1; i < threads; i++) {
+                            pool.emplace_back(work, i);
+                        }
+
+                        work(0);
+                        for(auto& i : pool) {
+                            i.join();
+                        }
+
+                        if(error) {
+                            std::rethrow_exception(error);
+                        }
+                        return;
+                    }
+                #endif
+
+                auto report = [&](const std::string& path, bool is_directory) {
+                    function(std::size_t(0), path, is_directory);
+                };
+                _private::walkDirectory(directory, report, descend);
+            }
+
+            #if defined(OS_HAS_IO_URING)
+                /*
+                    Submission and completion queues of an io_uring instance, set up with raw syscalls so no library is needed.
+                    `good()` is false if the kernel does not support io_uring or the operations used to copy files
+                    (Linux 5.6 and later), such as when it is disabled or blocked by a seccomp filter.
+                */
+                class IoUring {
+                    private:
+                        int fd_ = -1;
+                        void* sq_ring_ = nullptr;
+                        void* cq_ring_ = nullptr;
+                        std::size_t sq_ring_size_ = 0;
+                        std::size_t cq_ring_size_ = 0;
+                        io_uring_sqe* sqes_ = nullptr;
+                        std::size_t sqes_size_ = 0;
+                        unsigned int* sq_tail_ = nullptr;
+                        unsigned int* sq_mask_ = nullptr;
+                        unsigned int* sq_array_ = nullptr;
+                        unsigned int* cq_head_ = nullptr;
+                        unsigned int* cq_tail_ = nullptr;
+                        unsigned int* cq_mask_ = nullptr;
+                        io_uring_cqe* cqes_ = nullptr;
+                        unsigned int entries_ = 0;
+                        unsigned int tail_ = 0; // Tail of the submission queue including entries not submitted yet
+                        unsigned int unsubmitted_ = 0;
+
+                        void release()
+                        {
+                            if(sqes_) {
+                                ::munmap(sqes_, sqes_size_);
+                            }
+                            if(cq_ring_ && cq_ring_ != sq_ring_) {
+                                ::munmap(cq_ring_, cq_ring_size_);
+                            }
+                            if(sq_ring_) {
+                                ::munmap(sq_ring_, sq_ring_size_);
+                            }
+                            if(fd_ >= 0) {
+                                ::close(fd_);
+                            }
+
+                            sqes_ = nullptr;
+                            cq_ring_ = nullptr;
+                            sq_ring_ = nullptr;
+                            fd_ = -1;
+                        }
+
+                        static void* map(int fd, std::size_t size, off_t offset)
+                        {
+                            void* result = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+                            return result == MAP_FAILED ? nullptr : result;
+                        }
+
+                        bool supports(const std::vector<int>& operations) const
+                        {
+                            const unsigned int count = 256;
+                            std::vector<char> buffer(sizeof(io_uring_probe) + count * sizeof(io_uring_probe_op), 0);
+                            io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+                            if(::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, count) < 0) {
+                                return false;
+                            }
+
+                            for(int i : operations) {
+                                if(i > probe->last_op || !(probe->ops[i].flags & IO_URING_OP_SUPPORTED)) {
+                                    return false;
+                                }
+                            }
+
+                            return true;
+                        }
+
+                    public:
+                        explicit IoUring(unsigned int entries)
+                        {
+                            io_uring_params params;
+                            std::memset(&params, 0, sizeof(params));
+                            fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                            if(fd_ < 0) {
+                                return;
+                            }
+
+                            sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+                            cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+                            if(single_mmap) {
+                                sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+                            }
+
+                            sq_ring_ = map(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+                            cq_ring_ = single_mmap ? sq_ring_ : map(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+                            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+                            sqes_ = static_cast<io_uring_sqe*>(map(fd_, sqes_size_, IORING_OFF_SQES));
+                            if(!sq_ring_ || !cq_ring_ || !sqes_ || !supports({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_FALLOCATE, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE})) {
+                                release();
+                                return;
+                            }
+
+                            char* sq = static_cast<char*>(sq_ring_);
+                            char* cq = static_cast<char*>(cq_ring_);
+                            sq_tail_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+                            sq_mask_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+                            sq_array_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+                            cq_head_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+                            cq_tail_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+                            cq_mask_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+                            cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+                            entries_ = params.sq_entries;
+                            tail_ = *sq_tail_;
+                        }
+
+                        IoUring(const IoUring&) = delete;
+                        IoUring& operator=(const IoUring&) = delete;
+
+                        ~IoUring()
+                        {
+                            release();
+                        }
+
+                        bool good() const
+                        {
+                            return fd_ >= 0;
+                        }
+
+                        // Number of submission queue entries, which the kernel rounds up to a power of 2
+                        unsigned int entries() const
+                        {
+                            return entries_;
+                        }
+
+                        /*
+                            Returns a cleared submission queue entry to fill in. It is sent to the kernel with the next `submit()`.
+                            Callers must not have more than `entries()` operations in flight.
+                        */
+                        io_uring_sqe* next(__u64 user_data)
+                        {
+                            unsigned int index = tail_ & *sq_mask_;
+                            io_uring_sqe* sqe = &sqes_[index];
+                            std::memset(sqe, 0, sizeof(*sqe));
+                            sqe->user_data = user_data;
+                            sq_array_[index] = index;
+                            tail_++;
+                            unsubmitted_++;
+                            return sqe;
+                        }
+
+                        /*
+                            Sends the new entries to the kernel and waits for at least `wait_for` completions.
+                            Returns false on error.
+                        */
+                        bool submit(unsigned int wait_for)
+                        {
+                            __atomic_store_n(sq_tail_, tail_, __ATOMIC_RELEASE);
+                            while(true) {
+                                long result = ::syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait_for, wait_for > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+                                if(result >= 0) {
+                                    unsubmitted_ -= std::min<unsigned int>(unsubmitted_, static_cast<unsigned int>(result));
+                                    return true;
+                                }
+                                if(errno != EINTR) {
+                                    return false;
+                                }
+                            }
+                        }
+
+                        /*
+                            Calls a function with the user data and the result of each completed operation.
+                            The function may queue new entries with `next()`.
+                        */
+                        template<typename Function>
+                        void forEachCompletion(Function function)
+                        {
+                            unsigned int head = *cq_head_;
+                            while(head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                                io_uring_cqe cqe = cqes_[head & *cq_mask_];
+                                head++;
+                                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+                                function(cqe.user_data, cqe.res);
+                            }
+                        }
+                };
+
+                /*
+                    Copies files with io_uring, keeping the opens, stats, reads, writes and closes of many files in flight from one
+                    thread instead of waiting on each syscall. Files are cloned first as set by `setReflinkOption()`. Sparse files
+                    are copied over the worker pool afterwards, since their holes are found with `lseek()`, which io_uring has no
+                    operation for.
+                    Returns false without copying anything if io_uring is not available so the caller can fall back to threads.
+
+                    Parameters:
+                    `source_directory`: Directory the paths of the files to copy are relative to.
+                    `destination_directory`: Directory to copy the files to. Parent directories must exist.
+                    `files`: Paths of the files to copy.
+                */
+                inline bool copyFilesIoUring(int source_directory, int destination_directory, const std::vector<std::string>& files)
+                {
+                    if(files.empty()) {
+                        return true;
+                    }
+
+                    IoUring ring(std::max(3u, io_queue_depth));
+                    if(!ring.good()) {
+                        return false;
+                    }
+
+                    // The operation is kept in the low bits of the user data and the slot of the file in the rest
+                    enum Operation {OpenSource, OpenDestination, Stat, Allocate, Transfer, CloseSource, CloseDestination, OperationCount = 8};
+                    struct File {
+                        std::size_t index = 0;
+                        int in = -1;
+                        int out = -1;
+                        int pending = 0;
+                        bool has_info = false;
+                        bool reading = true;
+                        __u64 offset = 0;
+                        unsigned int length = 0;
+                        unsigned int written = 0;
+                        struct statx info;
+                    };
+
+                    // Every file in flight has at most 3 operations queued
+                    const std::size_t chunk_size = 128 * 1024;
+                    std::vector<File> slots(std::max<std::size_t>(1, std::min<std::size_t>(ring.entries() / 3, files.size())));
+                    std::vector<std::size_t> sparse_files;
+                    std::vector<char> buffers(slots.size() * chunk_size);
+                    std::size_t next_file = 0;
+                    std::size_t active = 0;
+                    std::size_t error_index = files.size();
+                    std::string error;
+
+                    // Keeps the error of the first failed file so the error does not depend on the order of completions
+                    auto fail = [&](std::size_t index, const std::string& message) {
+                        if(index < error_index) {
+                            error_index = index;
+                            error = "\"" + files[index] + "\" " + message;
+                        }
+                    };
+
+                    auto queueTransfer = [&](std::size_t slot) {
+                        File& file = slots[slot];
+                        io_uring_sqe* sqe = ring.next(slot * OperationCount + Transfer);
+                        sqe->opcode = file.reading ? IORING_OP_READ : IORING_OP_WRITE;
+                        sqe->fd = file.reading ? file.in : file.out;
+                        sqe->addr = reinterpret_cast<__u64>(&buffers[slot * chunk_size] + (file.reading ? 0 : file.written));
+                        sqe->len = file.reading ? chunk_size : file.length - file.written;
+                        sqe->off = file.offset + (file.reading ? 0 : file.written);
+                    };
+
+                    auto start = [&](std::size_t slot) {
+                        File& file = slots[slot];
+                        file = File();
+                        file.index = next_file++;
+                        file.pending = 3;
+                        active++;
+
+                        const int flags[2] = {O_RDONLY | O_CLOEXEC, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC};
+                        const int directories[2] = {source_directory, destination_directory};
+                        for(int i = 0; i < 2; i++) {
+                            io_uring_sqe* sqe = ring.next(slot * OperationCount + (i == 0 ? OpenSource : OpenDestination));
+                            sqe->opcode = IORING_OP_OPENAT;
+                            sqe->fd = directories[i];
+                            sqe->addr = reinterpret_cast<__u64>(files[file.index].c_str());
+                            sqe->open_flags = flags[i];
+                            sqe->len = 0666;
+                        }
+
+                        // Stat the source alongside the opens so no file waits on an `fstat()` of its own
+                        io_uring_sqe* sqe = ring.next(slot * OperationCount + Stat);
+                        sqe->opcode = IORING_OP_STATX;
+                        sqe->fd = source_directory;
+                        sqe->addr = reinterpret_cast<__u64>(files[file.index].c_str());
+                        sqe->len = STATX_TYPE | STATX_SIZE | STATX_BLOCKS;
+                        sqe->off = reinterpret_cast<__u64>(&file.info);
+                    };
+
+                    auto finish = [&](std::size_t slot) {
+                        active--;
+                        if(next_file < files.size()) {
+                            start(slot);
+                        }
+                    };
+
+                    auto closeFiles = [&](std::size_t slot) {
+                        File& file = slots[slot];
+                        for(int* fd : {&file.in, &file.out}) {
+                            if(*fd >= 0) {
+                                io_uring_sqe* sqe = ring.next(slot * OperationCount + (fd == &file.in ? CloseSource : CloseDestination));
+                                sqe->opcode = IORING_OP_CLOSE;
+                                sqe->fd = *fd;
+                                file.pending++;
+                                *fd = -1;
+                            }
+                        }
+
+                        if(file.pending == 0) {
+                            finish(slot);
+                        }
+                    };
+
+                    auto afterOpen = [&](std::size_t slot) {
+                        File& file = slots[slot];
+                        if(file.in < 0 || file.out < 0) {
+                            fail(file.index, "could not be opened: " + std::string(std::strerror(-(file.in < 0 ? file.in : file.out))));
+                            closeFiles(slot);
+                            return;
+                        }
+
+                        // Share the data blocks of the source if the filesystem supports it
+                        if(reflink_option != ReflinkOption::Never) {
+                            if(::ioctl(file.out, FICLONE, file.in) == 0) {
+                                closeFiles(slot);
+                                return;
+                            }
+
+                            if(reflink_option == ReflinkOption::Always) {
+                                fail(file.index, "could not be cloned");
+                                closeFiles(slot);
+                                return;
+                            }
+                        }
+
+                        if(file.has_info && S_ISREG(file.info.stx_mode)) {
+                            if(file.info.stx_blocks * 512 < file.info.stx_size) {
+                                sparse_files.push_back(file.index);
+                                closeFiles(slot);
+                                return;
+                            }
+
+                            if(preallocate_size > 0 && file.info.stx_size >= preallocate_size) {
+                                io_uring_sqe* sqe = ring.next(slot * OperationCount + Allocate);
+                                sqe->opcode = IORING_OP_FALLOCATE;
+                                sqe->fd = file.out;
+                                sqe->addr = file.info.stx_size;
+                                sqe->len = FALLOC_FL_KEEP_SIZE;
+                                return;
+                            }
+                        }
+
+                        queueTransfer(slot);
+                    };
+
+                    for(std::size_t i = 0; i < slots.size(); i++) {
+                        start(i);
+                    }
+
+                    while(active > 0) {
+                        if(!ring.submit(1)) {
+                            throw std::runtime_error(_private::errorMessage(__func__, "io_uring_enter() failed: " + std::string(std::strerror(errno))));
+                        }
+
+                        ring.forEachCompletion([&](__u64 user_data, int result) {
+                            std::size_t slot = user_data / OperationCount;
+                            File& file = slots[slot];
+                            switch(user_data % OperationCount) {
+                                case OpenSource:
+                                case OpenDestination:
+                                case Stat:
+                                    if(user_data % OperationCount == Stat) {
+                                        file.has_info = result == 0;
+                                    } else {
+                                        (user_data % OperationCount == OpenSource ? file.in : file.out) = result;
+                                    }
+                                    if(--file.pending == 0) {
+                                        afterOpen(slot);
+                                    }
+                                    break;
+                                case Allocate: // Only a hint, so a failure is not an error
+                                    queueTransfer(slot);
+                                    break;
+                                case Transfer:
+                                    if(result == -EINTR || result == -EAGAIN) {
+                                        queueTransfer(slot);
+                                    } else if(result < 0 || (result == 0 && !file.reading)) {
+                                        fail(file.index, "could not be copied: " + std::string(std::strerror(result < 0 ? -result : ENOSPC)));
+                                        closeFiles(slot);
+                                    } else if(result == 0) { // end of file
+                                        closeFiles(slot);
+                                    } else {
+                                        if(file.reading) {
+                                            file.length = result;
+                                            file.written = 0;
+                                            file.reading = false;
+                                        } else {
+                                            file.written += result;
+                                            if(file.written == file.length) {
+                                                file.offset += file.length;
+                                                file.reading = true;
+                                            }
+                                        }
+                                        queueTransfer(slot);
+                                    }
+                                    break;
+                                case CloseSource:
+                                case CloseDestination:
+                                    // Delayed write errors of the destination can show up only here
+                                    if(user_data % OperationCount == CloseDestination && result < 0) {
+                                        fail(file.index, "could not be closed: " + std::string(std::strerror(-result)));
+                                    }
+                                    if(--file.pending == 0) {
+                                        finish(slot);
+                                    }
+                                    break;
+                            }
+                        });
+                    }
+
+                    if(!error.empty()) {
+                        throw std::runtime_error(_private::errorMessage(__func__, error));
+                    }
+
+                    parallel::forEach(sparse_files.size(), copy_thread_count, [&](std::size_t i) {
+                        const char* file = files[sparse_files[i]].c_str();
+                        if(!copyFileAt(source_directory, file, destination_directory, file)) {
+                            throw std::runtime_error(_private::errorMessage(__func__, "\"" + files[sparse_files[i]] + "\" could not be copied: " + std::strerror(errno)));
+                        }
+                    });
+
+                    return true;
+                }
+            #endif
+
+            #if defined(__linux__)
+                /*
+                    Copies a set of paths the way `copy()` does while resolving each path only once. The source and
+                    destination are opened once and every path is looked up, made and opened relative to them with
+                    `fstatat()`, `mkdirat()` and `openat()`, so a file costs the same few syscalls however deep it is.
+                    Files are copied over the worker pool in groups of the same directory and each group opens its
+                    two directories once, or all at once with io_uring as set by `setIoBackend()`.
+
+                    Parameters:
+                    `source`: Directory the paths are relative to.
+                    `paths`: Paths to copy.
+                    `destination`: Directory to copy the paths to.
+                    `op`: What to do with paths that already exist in the destination.
+                */
+                inline bool copyAt(const std::filesystem::path& source, const std::set<std::string>& paths, 
+                                   const std::filesystem::path& destination, const CopyOption& op)
+                {
+                    std::filesystem::create_directories(destination);
+
+                    FileDescriptor source_directory(::open(source.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+                    if(source_directory.get() < 0) {
+                        throw std::runtime_error(_private::errorMessage(__func__, "\"" + source.string() + "\" could not be opened"));
+                    }
+
+                    FileDescriptor destination_directory(::open(destination.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+                    if(destination_directory.get() < 0) {
+                        throw std::runtime_error(_private::errorMessage(__func__, "\"" + destination.string() + "\" could not be opened"));
+                    }
+
+                    // The paths are sorted out first. Then every directory is made once, parents first, and the files
+                    // are copied by the worker pool in groups of the same directory without checking for parents.
+                    std::vector<std::filesystem::path> directories;
+                    std::map<std::string, std::vector<std::string>> files;
+                    auto copyGroups = [&]() {
+                        for(const auto& i : files) {
+                            directories.push_back(i.first);
+                        }
+
+                        for(const auto& i : path::directoryPlan(directories)) {
+                            if(::mkdirat(destination_directory.get(), i.c_str(), 0777) != 0) {
+                                struct stat info;
+                                if(errno != EEXIST || ::fstatat(destination_directory.get(), i.c_str(), &info, 0) != 0 || !S_ISDIR(info.st_mode)) {
+                                    throw std::runtime_error(_private::errorMessage(__func__, "\"" + (destination / i).string() + "\" could not be made"));
+                                }
+                            }
+                        }
+
+                        #if defined(OS_HAS_IO_URING)
+                            if(io_backend == IoBackend::IoUring) {
+                                std::vector<std::string> relative_paths;
+                                for(const auto& i : files) {
+                                    for(const auto& j : i.second) {
+                                        relative_paths.push_back(i.first.empty() ? j : i.first + "/" + j);
+                                    }
+                                }
+
+                                if(copyFilesIoUring(source_directory.get(), destination_directory.get(), relative_paths)) {
+                                    return;
+                                }
+                            }
+                        #endif
+
+                        const std::size_t group_size = 64;
+                        std::vector<std::pair<std::map<std::string, std::vector<std::string>>::const_iterator, std::size_t>> groups;
+                        for(auto i = files.cbegin(); i != files.cend(); i++) {
+                            for(std::size_t j = 0; j < i->second.size(); j += group_size) {
+                                groups.push_back({i, j});
+                            }
+                        }
+
+                        parallel::forEach(groups.size(), copy_thread_count, [&](std::size_t i) {
+                            const std::string& directory = groups[i].first->first;
+                            const std::vector<std::string>& names = groups[i].first->second;
+                            const char* name = directory.empty() ? "." : directory.c_str();
+
+                            FileDescriptor from(::openat(source_directory.get(), name, O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+                            FileDescriptor to(::openat(destination_directory.get(), name, O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+                            if(from.get() < 0) {
+                                throw std::runtime_error(_private::errorMessage(__func__, "\"" + (source / directory).string() + "\" could not be opened"));
+                            }
+                            if(to.get() < 0) {
+                                throw std::runtime_error(_private::errorMessage(__func__, "\"" + (destination / directory).string() + "\" could not be opened"));
+                            }
+
+                            std::size_t end = std::min(names.size(), groups[i].second + group_size);
+                            for(std::size_t j = groups[i].second; j < end; j++) {
+                                if(!copyFileAt(from.get(), names[j].c_str(), to.get(), names[j].c_str())) {
+                                    std::filesystem::path file = std::filesystem::path(directory) / names[j];
+                                    throw std::runtime_error(_private::errorMessage(__func__, "\"" + (source / file).string() + "\" could not be copied to \"" +
+                                                                                   (destination / file).string() + "\": " + std::strerror(errno)));
+                                }
+                            }
+                        });
+                    };
+
+                    char ch = 0;
+                    for(const auto& i : paths) {
+                        std::filesystem::path relative = std::filesystem::path(i).lexically_normal();
+                        if(!relative.has_filename()) {
+                            relative = relative.parent_path();
+                        }
+
+                        if(relative.empty() || relative == ".") {
+                            continue;
+                        }
+
+                        struct stat source_info;
+                        if(::fstatat(source_directory.get(), relative.c_str(), &source_info, 0) != 0) {
+                            continue;
+                        }
+
+                        struct stat destination_info;
+                        bool destination_exists = ::fstatat(destination_directory.get(), relative.c_str(), &destination_info, 0) == 0;
+
+                        // display warning
+                        if(op == CopyOption::None && destination_exists && ch != 'a' && ch != 'A') {
+                            ch = _private::copyWarning(path::relativePath(destination / relative));
+                        }
+
+                        // Files accepted before cancelling are still copied
+                        if(ch == 'x' || ch == 'X') {
+                            copyGroups();
+                            return false;
+                        }
+
+                        if(S_ISDIR(source_info.st_mode)) {
+                            directories.push_back(relative);
+                        } else if(!destination_exists || op == CopyOption::OverwriteExisting || ch == 'y' || ch == 'Y' || ch == 'a' || ch == 'A') {
+                            files[relative.parent_path().native()].push_back(relative.filename().native());
+                        }
+                    }
+
+                    copyGroups();
+                    return true;
+                }
+            #endif
+
             inline bool copy(const std::filesystem::path& source, const std::filesystem::path& destination, 
                              const CopyOption& op, const TraversalOption& t_op)
             {
@@ -643,27 +2324,42 @@ namespace os {
                         }
                     }
 
-                    for(int i = 0; i < paths.size(); i++) {
-                        std::filesystem::path source = std::filesystem::weakly_canonical(from / paths[i]);
-                        std::filesystem::path copy_to = std::filesystem::weakly_canonical(to / paths[i]);
-                        bool is_source_dir = std::filesystem::is_directory(source);
-                        bool destination_exists = std::filesystem::exists(copy_to);
-                        
-                        // display warning
-                        if(op == CopyOption::None && destination_exists && ch != 'a' && ch != 'A') {
-                            ch = _private::copyWarning(path::relativePath(copy_to));
+                    #if defined(__linux__)
+                        std::set<std::string> relative_paths;
+                        for(const auto& i : paths) {
+                            relative_paths.insert(i.string());
                         }
-
-                        if(ch == 'x' || ch == 'X') {
-                            return false;
+                        
+                        return _private::copyAt(from, relative_paths, to, op);
+                    #else
+                        // Directories are made in order while the files to copy are collected for the worker pool
+                        std::vector<std::pair<std::filesystem::path, std::filesystem::path>> files;
+                        for(int i = 0; i < paths.size(); i++) {
+                            std::filesystem::path source = std::filesystem::weakly_canonical(from / paths[i]);
+                            std::filesystem::path copy_to = std::filesystem::weakly_canonical(to / paths[i]);
+                            bool is_source_dir = std::filesystem::is_directory(source);
+                            bool destination_exists = std::filesystem::exists(copy_to);
+                        
+                            // display warning
+                            if(op == CopyOption::None && destination_exists && ch != 'a' && ch != 'A') {
+                                ch = _private::copyWarning(path::relativePath(copy_to));
+                            }
+
+                            // Files accepted before cancelling are still copied
+                            if(ch == 'x' || ch == 'X') {
+                                _private::copyFiles(files);
+                                return false;
+                            }
+
+                            if(is_source_dir) { 
+                                std::filesystem::create_directories(copy_to);
+                            } else if(!destination_exists || op == CopyOption::OverwriteExisting || ch == 'y' || ch == 'Y' || ch == 'a' || ch == 'A') {
+                                files.push_back({source, copy_to});
+                            } 
                         }
 
-                        if(is_source_dir) { 
-                            std::filesystem::create_directories(copy_to);
-                        } else if(!destination_exists || op == CopyOption::OverwriteExisting || ch == 'y' || ch == 'Y' || ch == 'a' || ch == 'A') {
-                            _private::copyFile(source, copy_to);
-                        } 
-                    }
+                        _private::copyFiles(files);
+                    #endif
                 } else { // is file
                     if(isDirectoryString(from)) {
                         from = from.parent_path();
@@ -692,7 +2388,7 @@ namespace os {
                     if(is_source_dir) { 
                         std::filesystem::create_directories(copy_to);
                     } else if(!destination_exists || op == CopyOption::OverwriteExisting || ch == 'y' || ch == 'Y' || ch == 'a' || ch == 'A') {
-                        _private::copyFile(from, copy_to);
+                        path::copyFile(from, copy_to);
                     } 
                 }
 
@@ -706,37 +2402,62 @@ namespace os {
                     throw std::runtime_error(_private::errorMessage(__func__, "\"" + source.string() + "\" does not exist"));
                 }
 
+                // Build the new tree next to the destination and swap it in so the destination is never half-written
                 if(op == CopyOption::OverwriteAll) {
+                    std::filesystem::path staging = path::makeStagingDirectory(destination);
+                    if(!staging.empty()) {
+                        bool result = false;
+                        try {
+                            result = _private::copy(source, paths, staging, CopyOption::OverwriteExisting);
+                        } catch(...) {
+                            std::error_code ec;
+                            std::filesystem::remove_all(staging, ec);
+                            throw;
+                        }
+
+                        path::replaceDirectory(staging, destination);
+                        return result;
+                    }
+
                     for(const auto& entry : std::filesystem::directory_iterator(destination)) {
                         path::remove(entry.path());
                     }
                 }
 
-                char ch;
-                for(const auto& i : paths) {
-                    std::filesystem::path from = std::filesystem::weakly_canonical(source / i);
-                    std::filesystem::path to = std::filesystem::weakly_canonical(destination / std::filesystem::relative(from, source));
-
-                    bool destination_exists = std::filesystem::exists(to);
-                    bool is_source_dir = std::filesystem::is_directory(from);
+                #if defined(__linux__)
+                    return _private::copyAt(source, paths, destination, op);
+                #else
+                    // Directories are made in order while the files to copy are collected for the worker pool
+                    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> files;
+                    char ch;
+                    for(const auto& i : paths) {
+                        std::filesystem::path from = std::filesystem::weakly_canonical(source / i);
+                        std::filesystem::path to = std::filesystem::weakly_canonical(destination / std::filesystem::relative(from, source));
+
+                        bool destination_exists = std::filesystem::exists(to);
+                        bool is_source_dir = std::filesystem::is_directory(from);
                     
-                    // display warning
-                    if(op == CopyOption::None && destination_exists && ch != 'a' && ch != 'A') {
-                        ch = _private::copyWarning(path::relativePath(to));
-                    }
+                        // display warning
+                        if(op == CopyOption::None && destination_exists && ch != 'a' && ch != 'A') {
+                            ch = _private::copyWarning(path::relativePath(to));
+                        }
 
-                    if(ch == 'x' || ch == 'X') {
-                        return false;
-                    }
+                        // Files accepted before cancelling are still copied
+                        if(ch == 'x' || ch == 'X') {
+                            _private::copyFiles(files);
+                            return false;
+                        }
 
-                    if(is_source_dir) { 
-                        std::filesystem::create_directories(to);
-                    } else if(!destination_exists || op == CopyOption::OverwriteExisting || ch == 'y' || ch == 'Y' || ch == 'a' || ch == 'A') {
-                        _private::copyFile(from, to);
-                    } 
-                }
+                        if(is_source_dir) { 
+                            std::filesystem::create_directories(to);
+                        } else if(!destination_exists || op == CopyOption::OverwriteExisting || ch == 'y' || ch == 'Y' || ch == 'a' || ch == 'A') {
+                            files.push_back({from, to});
+                        } 
+                    }
 
-                return true;
+                    _private::copyFiles(files);
+                    return true;
+                #endif
             }
 
             inline bool move(const std::filesystem::path& source, const std::filesystem::path& destination, 
@@ -772,6 +2493,108 @@ namespace os {
         }
     }
 
+    /*
+        Read-only view of the whole content of a file.
+        The file is memory-mapped where supported and read into memory otherwise.
+    */
+    class MappedFile {
+        private:
+            const char* data_ = nullptr;
+            std::size_t size_ = 0;
+            bool open_ = false;
+            std::string buffer_; // Content of the file when it could not be mapped
+            #if defined(__linux__)
+                void* map_ = nullptr;
+            #endif
+
+        public:
+            MappedFile(const std::filesystem::path& path)
+            {
+                data_ = buffer_.data();
+
+                #if defined(__linux__)
+                    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                    if(fd >= 0) {
+                        struct stat st;
+                        if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+                            if(st.st_size == 0) {
+                                ::close(fd);
+                                open_ = true;
+                                return;
+                            }
+
+                            map_ = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                            if(map_ != MAP_FAILED) {
+                                ::close(fd);
+                                ::madvise(map_, st.st_size, MADV_SEQUENTIAL);
+                                data_ = static_cast<const char*>(map_);
+                                size_ = st.st_size;
+                                open_ = true;
+                                return;
+                            }
+                            map_ = nullptr;
+                        }
+                        ::close(fd);
+                    }
+                #endif
+
+                // Fall back to reading the whole file
+                std::ifstream file(path, std::ios::binary | std::ios::ate);
+                std::streamoff size = file.is_open() ? static_cast<std::streamoff>(file.tellg()) : -1;
+                if(size < 0) {
+                    return;
+                }
+
+                buffer_.resize(size);
+                file.seekg(0, std::ios::beg);
+                file.read(buffer_.data(), buffer_.size());
+                buffer_.resize(file.gcount());
+                data_ = buffer_.data();
+                size_ = buffer_.size();
+                open_ = true;
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            ~MappedFile()
+            {
+                close();
+            }
+
+            // Releases the mapping. Has to be called before the file is truncated or rewritten.
+            void close()
+            {
+                #if defined(__linux__)
+                    if(map_ != nullptr) {
+                        ::munmap(map_, size_);
+                        map_ = nullptr;
+                    }
+                #endif
+
+                buffer_.clear();
+                buffer_.shrink_to_fit();
+                data_ = buffer_.data();
+                size_ = 0;
+                open_ = false;
+            }
+
+            bool isOpen() const
+            {
+                return open_;
+            }
+
+            const char* data() const
+            {
+                return data_;
+            }
+
+            std::size_t size() const
+            {
+                return size_;
+            }
+    };
+
     inline std::string execute(const std::string& command, const std::string& mode = "r")
     {
         FILE* pipe = popen(command.c_str(), mode.c_str());
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+namespace parallel {
+
+    /*
+        Returns the number of threads to use.
+
+        Parameters:
+        `requested`: Number of threads asked for. (0 to use every hardware thread)
+    */
+    inline unsigned int threadCount(unsigned int requested = 0)
+    {
+        if(requested > 0) {
+            return requested;
+        }
+
+        unsigned int hardware = std::thread::hardware_concurrency();
+        return hardware > 0 ? hardware : 1;
+    }
+
+    /*
+        Calls a function for each task, spreading the tasks across a pool of threads.
+        Threads take the tasks in the given order, so putting the largest tasks first balances the work.
+        If tasks throw, every other task still runs and the exception of the smallest task is rethrown,
+        so the error does not depend on how the threads were scheduled.
+
+        Parameters:
+        `tasks`: Tasks to run, in the order they should be taken. Each task is an index smaller than the number of tasks.
+        `thread_count`: Number of threads to use. (0 to use every hardware thread)
+        `function`: Called with each task.
+    */
+    template<typename Function>
+    void forEach(const std::vector<std::size_t>& tasks, unsigned int thread_count, Function function)
+    {
+        std::size_t threads = std::min<std::size_t>(threadCount(thread_count), tasks.size());
+        std::vector<std::exception_ptr> errors(tasks.size());
+        std::atomic<std::size_t> next(0);
+
+        auto work = [&]() {
+            for(std::size_t i = next++; i < tasks.size(); i = next++) {
+                try {
+                    function(tasks[i]);
+                } catch(...) {
+                    errors[tasks[i]] = std::current_exception();
+                }
+            }
+        };
+
+        if(threads <= 1) {
+            work();
+        } else {
+            std::vector<std::thread> pool;
+            pool.reserve(threads - 1);
+            for(std::size_t i = 1; i < threads; i++) {
+                pool.emplace_back(work);
+            }
+
+            work();
+            for(auto& i : pool) {
+                i.join();
+            }
+        }
+
+        for(const auto& i : errors) {
+            if(i) {
+                std::rethrow_exception(i);
+            }
+        }
+    }
+
+    /*
+        Calls a function for each task from 0 to `count`, spreading the tasks across a pool of threads.
+
+        Parameters:
+        `count`: Number of tasks.
+        `thread_count`: Number of threads to use. (0 to use every hardware thread)
+        `function`: Called with each task.
+    */
+    template<typename Function>
+    void forEach(std::size_t count, unsigned int thread_count, Function function)
+    {
+        std::vector<std::size_t> tasks(count);
+        for(std::size_t i = 0; i < count; i++) {
+            tasks[i] = i;
+        }
+
+        forEach(tasks, thread_count, function);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,659 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <set>
+#include <initializer_list>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+#include <utility>
+
+namespace pathtable {
+
+    /*
+        Sorted set of paths stored in one contiguous buffer. Each path is front coded: only the part that differs from
+        the path before it is stored, and every `restart_interval`-th path is stored whole so a path can be found with
+        a binary search. Paths of a template share most of their directories, so the table takes a fraction of the memory
+        of a `std::set<std::string>`, which needs a tree node and usually a string allocation for every path.
+        The id of a path is its position in sorted order and does not change for the life of the table.
+    */
+    class PathTable {
+        public:
+            static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+            static constexpr std::size_t restart_interval = 16;
+
+            /*
+                Iterates the paths in sorted order. The path is decoded into the iterator, so a reference to it
+                is only valid until the iterator is moved.
+            */
+            class Iterator {
+                private:
+                    const PathTable* table_ = nullptr;
+                    std::size_t id_ = 0;
+                    std::size_t next_offset_ = 0;
+                    std::string path_;
+
+                    friend class PathTable;
+
+                public:
+                    using iterator_category = std::forward_iterator_tag;
+                    using value_type = std::string;
+                    using difference_type = std::ptrdiff_t;
+                    using pointer = const std::string*;
+                    using reference = const std::string&;
+
+                    const std::string& operator*() const
+                    {
+                        return path_;
+                    }
+
+                    const std::string* operator->() const
+                    {
+                        return &path_;
+                    }
+
+                    std::size_t id() const
+                    {
+                        return id_;
+                    }
+
+                    Iterator& operator++()
+                    {
+                        if(++id_ < table_->size_) {
+                            next_offset_ = table_->decode(next_offset_, path_);
+                        }
+                        return *this;
+                    }
+
+                    Iterator operator++(int)
+                    {
+                        Iterator previous = *this;
+                        ++*this;
+                        return previous;
+                    }
+
+                    bool operator==(const Iterator& other) const
+                    {
+                        return id_ == other.id_ && table_ == other.table_;
+                    }
+
+                    bool operator!=(const Iterator& other) const
+                    {
+                        return !(*this == other);
+                    }
+            };
+
+        private:
+            std::vector<char> data_;
+            std::vector<std::size_t> restarts_; // Offset of every path that is stored whole
+            std::size_t size_ = 0;
+            std::string last_;
+
+            static void writeLength(std::vector<char>& data, std::size_t length)
+            {
+                while(length >= 0x80) {
+                    data.push_back(static_cast<char>(length | 0x80));
+                    length >>= 7;
+                }
+                data.push_back(static_cast<char>(length));
+            }
+
+            static std::size_t readLength(const char*& p)
+            {
+                std::size_t length = 0;
+                for(int shift = 0;; shift += 7) {
+                    unsigned char byte = static_cast<unsigned char>(*p++);
+                    length |= static_cast<std::size_t>(byte & 0x7f) << shift;
+                    if(byte < 0x80) {
+                        return length;
+                    }
+                }
+            }
+
+            // Decodes the path at `offset` over the path before it and returns the offset of the path after it
+            std::size_t decode(std::size_t offset, std::string& path) const
+            {
+                const char* p = data_.data() + offset;
+                std::size_t shared = readLength(p);
+                std::size_t length = readLength(p);
+                path.resize(shared);
+                path.append(p, length);
+                return p + length - data_.data();
+            }
+
+            // Path stored whole at the start of a restart block
+            std::string_view restartPath(std::size_t restart) const
+            {
+                const char* p = data_.data() + restarts_[restart];
+                readLength(p);
+                std::size_t length = readLength(p);
+                return std::string_view(p, length);
+            }
+
+        public:
+            PathTable() = default;
+
+            // Not explicit, so code that passes a `std::set<std::string>` keeps working
+            PathTable(const std::set<std::string>& paths)
+            {
+                for(const auto& i : paths) {
+                    push_back(i);
+                }
+                shrinkToFit();
+            }
+
+            PathTable(std::initializer_list<std::string> paths) : PathTable(std::vector<std::string>(paths)) {}
+
+            // Sorts the paths and leaves out duplicates
+            explicit PathTable(std::vector<std::string> paths)
+            {
+                if(!std::is_sorted(paths.begin(), paths.end())) {
+                    std::sort(paths.begin(), paths.end());
+                }
+                paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+                for(const auto& i : paths) {
+                    push_back(i);
+                }
+                shrinkToFit();
+            }
+
+            /*
+                Adds a path after every path in the table.
+
+                Parameters:
+                `path`: Path to add. Throws if it does not sort after the last path.
+            */
+            void push_back(std::string_view path)
+            {
+                if(size_ > 0 && path <= last_) {
+                    throw std::invalid_argument("PathTable::push_back(): \"" + std::string(path) + "\" does not sort after \"" + last_ + "\"");
+                }
+
+                std::size_t shared = 0;
+                if(size_ % restart_interval == 0) {
+                    restarts_.push_back(data_.size());
+                } else {
+                    std::size_t limit = std::min(path.size(), last_.size());
+                    while(shared < limit && path[shared] == last_[shared]) {
+                        shared++;
+                    }
+                }
+
+                writeLength(data_, shared);
+                writeLength(data_, path.size() - shared);
+                data_.insert(data_.end(), path.begin() + shared, path.end());
+                last_.assign(path);
+                size_++;
+            }
+
+            std::size_t size() const
+            {
+                return size_;
+            }
+
+            bool empty() const
+            {
+                return size_ == 0;
+            }
+
+            Iterator begin() const
+            {
+                return iteratorAt(0);
+            }
+
+            Iterator end() const
+            {
+                Iterator it;
+                it.table_ = this;
+                it.id_ = size_;
+                return it;
+            }
+
+            // Iterator at the path with the given id, or `end()` if there is none
+            Iterator iteratorAt(std::size_t id) const
+            {
+                if(id >= size_) {
+                    return end();
+                }
+
+                Iterator it;
+                it.table_ = this;
+                it.id_ = id;
+                it.next_offset_ = restarts_[id / restart_interval];
+                for(std::size_t i = id - id % restart_interval; i <= id; i++) {
+                    it.next_offset_ = decode(it.next_offset_, it.path_);
+                }
+                return it;
+            }
+
+            std::string operator[](std::size_t id) const
+            {
+                return *iteratorAt(id);
+            }
+
+            // Id of the first path that does not sort before `path`, or `size()` if there is none
+            std::size_t lowerBound(std::string_view path) const
+            {
+                std::size_t low = 0;
+                std::size_t high = restarts_.size();
+                while(low < high) {
+                    std::size_t middle = low + (high - low) / 2;
+                    if(restartPath(middle) <= path) {
+                        low = middle + 1;
+                    } else {
+                        high = middle;
+                    }
+                }
+
+                // Only the block before the first restart that sorts after `path` can hold it
+                if(low == 0) {
+                    return 0;
+                }
+
+                for(Iterator it = iteratorAt((low - 1) * restart_interval); it != end() && it.id() < low * restart_interval; ++it) {
+                    if(std::string_view(*it) >= path) {
+                        return it.id();
+                    }
+                }
+
+                return std::min(low * restart_interval, size_);
+            }
+
+            // Id of a path, or `npos` if it is not in the table
+            std::size_t find(std::string_view path) const
+            {
+                std::size_t id = lowerBound(path);
+                return id < size_ && (*this)[id] == path ? id : npos;
+            }
+
+            std::size_t count(std::string_view path) const
+            {
+                return find(path) != npos ? 1 : 0;
+            }
+
+            std::set<std::string> toSet() const
+            {
+                return std::set<std::string>(begin(), end());
+            }
+
+            // Bytes held by the table
+            std::size_t memoryUsage() const
+            {
+                return sizeof(*this) + data_.capacity() + restarts_.capacity() * sizeof(std::size_t) + last_.capacity();
+            }
+
+            void shrinkToFit()
+            {
+                data_.shrink_to_fit();
+                restarts_.shrink_to_fit();
+            }
+
+            bool operator==(const PathTable& other) const
+            {
+                return size_ == other.size_ && data_ == other.data_;
+            }
+
+            bool operator!=(const PathTable& other) const
+            {
+                return !(*this == other);
+            }
+    };
+
+    namespace _private {
+
+        // Walks two tables in step like `std::set_union()` and friends, adding the paths `keep` accepts
+        template<typename Keep>
+        PathTable merge(const PathTable& a, const PathTable& b, Keep keep)
+        {
+            PathTable result;
+            auto i = a.begin();
+            auto j = b.begin();
+            while(i != a.end() || j != b.end()) {
+                int order = i == a.end() ? 1 : j == b.end() ? -1 : i->compare(*j);
+                if(keep(order <= 0, order >= 0)) {
+                    result.push_back(order <= 0 ? *i : *j);
+                }
+
+                if(order <= 0) {
+                    ++i;
+                }
+                if(order >= 0) {
+                    ++j;
+                }
+            }
+
+            result.shrinkToFit();
+            return result;
+        }
+    }
+
+    // Paths in either table
+    inline PathTable unite(const PathTable& a, const PathTable& b)
+    {
+        return _private::merge(a, b, [](bool, bool) {
+            return true;
+        });
+    }
+
+    // Paths in both tables
+    inline PathTable intersect(const PathTable& a, const PathTable& b)
+    {
+        return _private::merge(a, b, [](bool in_a, bool in_b) {
+            return in_a && in_b;
+        });
+    }
+
+    // Paths in `a` that are not in `b`
+    inline PathTable subtract(const PathTable& a, const PathTable& b)
+    {
+        return _private::merge(a, b, [](bool in_a, bool in_b) {
+            return in_a && !in_b;
+        });
+    }
+    /*
+        Tree of the paths of a table with one node for every file and directory. Nodes are stored in pre-order, so the
+        descendants of a node are the nodes right after it up to `subtreeEnd()`, and a whole directory is skipped or
+        selected with one jump. The children of a node are stored next to each other and sorted by name.
+        Directories that hold a path of the table but are not in it themselves get a node with no id.
+    */
+    class PathTree {
+        private:
+            struct Node {
+                std::size_t parent = 0;
+                std::size_t subtree_end = 0; // Node after the last descendant
+                std::size_t first_child = 0; // Position of the first child in `children_`
+                std::size_t child_count = 0;
+                std::size_t name_offset = 0;
+                std::size_t name_length = 0;
+                std::size_t id = PathTable::npos; // Id of the path in the table
+            };
+
+            std::vector<Node> nodes_; // Pre-order, starting with the root
+            std::vector<std::size_t> children_;
+            std::string names_;
+            char separator_;
+
+        public:
+            static constexpr std::size_t npos = PathTable::npos;
+
+            /*
+                Parameters:
+                `paths`: Paths relative to the root of the tree.
+                `separator`: Character between the segments of a path.
+            */
+            explicit PathTree(const PathTable& paths, char separator = '/') : separator_(separator)
+            {
+                // The table is decoded once in its own order, where a directory can be interrupted by siblings
+                // such as "a-c" and "a.txt" between "a" and "a/b". Nodes are linked to their last child first
+                // and laid out in pre-order afterwards.
+                struct Building {
+                    std::size_t parent = 0;
+                    std::size_t last_child = npos;
+                    std::size_t previous_sibling = npos;
+                    std::size_t name_offset = 0;
+                    std::size_t name_length = 0;
+                    std::size_t id = npos;
+                };
+
+                std::vector<Building> built(1);
+                auto builtName = [&](std::size_t node) {
+                    return std::string_view(names_.data() + built[node].name_offset, built[node].name_length);
+                };
+
+                std::vector<std::pair<std::size_t, std::size_t>> chain = {{0, 0}}; // Directories of the last path and the length of their paths
+                std::string last;
+                for(auto it = paths.begin(); it != paths.end(); ++it) {
+                    const std::string& path = *it;
+                    std::size_t common = std::mismatch(path.begin(), path.begin() + std::min(path.size(), last.size()), last.begin()).first - path.begin();
+                    while(chain.size() > 1 && (chain.back().second > common || path.size() <= chain.back().second || path[chain.back().second] != separator_)) {
+                        chain.pop_back();
+                    }
+
+                    std::size_t node = chain.back().first;
+                    std::size_t begin = chain.back().second;
+                    while(begin < path.size()) {
+                        if(path[begin] == separator_) {
+                            begin++;
+                            continue;
+                        }
+
+                        std::size_t end = std::min(path.find(separator_, begin), path.size());
+                        std::string_view segment(path.data() + begin, end - begin);
+
+                        // Children made since a child named `segment` can only be the siblings that sort between it and its contents
+                        std::size_t child = built[node].last_child;
+                        while(child != npos) {
+                            std::string_view name = builtName(child);
+                            if(name == segment) {
+                                break;
+                            }
+                            if(name.size() <= segment.size() || name.compare(0, segment.size(), segment) != 0 ||
+                               static_cast<unsigned char>(name[segment.size()]) >= static_cast<unsigned char>(separator_)) {
+                                child = npos;
+                                break;
+                            }
+                            child = built[child].previous_sibling;
+                        }
+
+                        if(child == npos) {
+                            Building b;
+                            b.parent = node;
+                            b.previous_sibling = built[node].last_child;
+                            b.name_offset = names_.size();
+                            b.name_length = segment.size();
+                            names_.append(segment);
+                            child = built.size();
+                            built[node].last_child = child;
+                            built.push_back(b);
+                        }
+
+                        node = child;
+                        begin = end;
+                        chain.emplace_back(node, end);
+                    }
+                    built[node].id = it.id();
+                    last.assign(path);
+                }
+
+                // Lay the nodes out in pre-order with the children of each node sorted by name. The slot of a node
+                // in `children_` is given out when its parent is laid out and filled in when it is laid out itself.
+                nodes_.reserve(built.size());
+                children_.resize(built.size() - 1);
+                std::size_t next_slot = 0;
+                std::vector<std::size_t> sorted;
+                std::vector<std::pair<std::size_t, std::size_t>> stack = {{0, npos}}; // Node being built and its slot
+                while(!stack.empty()) {
+                    std::size_t b = stack.back().first;
+                    std::size_t slot = stack.back().second;
+                    stack.pop_back();
+
+                    std::size_t index = nodes_.size();
+                    Node node;
+                    node.name_offset = built[b].name_offset;
+                    node.name_length = built[b].name_length;
+                    node.id = built[b].id;
+                    node.subtree_end = index + 1;
+                    if(slot != npos) {
+                        children_[slot] = index;
+                    }
+
+                    sorted.clear();
+                    for(std::size_t i = built[b].last_child; i != npos; i = built[i].previous_sibling) {
+                        sorted.push_back(i);
+                    }
+                    std::sort(sorted.begin(), sorted.end(), [&](std::size_t x, std::size_t y) {
+                        return builtName(x) < builtName(y);
+                    });
+
+                    node.first_child = next_slot;
+                    node.child_count = sorted.size();
+                    next_slot += sorted.size();
+                    for(std::size_t i = sorted.size(); i-- > 0;) {
+                        stack.emplace_back(sorted[i], node.first_child + i);
+                    }
+                    nodes_.push_back(node);
+                }
+
+                // Point the children at their parents and extend every subtree over the subtrees inside it
+                for(std::size_t i = 0; i < nodes_.size(); i++) {
+                    for(std::size_t j = 0; j < nodes_[i].child_count; j++) {
+                        nodes_[children_[nodes_[i].first_child + j]].parent = i;
+                    }
+                }
+                for(std::size_t i = nodes_.size(); i-- > 1;) {
+                    std::size_t parent = nodes_[i].parent;
+                    nodes_[parent].subtree_end = std::max(nodes_[parent].subtree_end, nodes_[i].subtree_end);
+                }
+                names_.shrink_to_fit();
+            }
+
+            // Number of nodes, counting the root
+            std::size_t size() const
+            {
+                return nodes_.size();
+            }
+
+            std::size_t root() const
+            {
+                return 0;
+            }
+
+            std::size_t parent(std::size_t node) const
+            {
+                return nodes_[node].parent;
+            }
+
+            // Node after the last descendant of `node`
+            std::size_t subtreeEnd(std::size_t node) const
+            {
+                return nodes_[node].subtree_end;
+            }
+
+            std::size_t childCount(std::size_t node) const
+            {
+                return nodes_[node].child_count;
+            }
+
+            std::size_t child(std::size_t node, std::size_t index) const
+            {
+                return children_[nodes_[node].first_child + index];
+            }
+
+            // Id of the path of the node in the table, or `npos` if the table does not hold it
+            std::size_t id(std::size_t node) const
+            {
+                return nodes_[node].id;
+            }
+
+            std::string_view name(std::size_t node) const
+            {
+                return std::string_view(names_.data() + nodes_[node].name_offset, nodes_[node].name_length);
+            }
+
+            std::string path(std::size_t node) const
+            {
+                std::vector<std::size_t> chain;
+                for(; node != root(); node = parent(node)) {
+                    chain.push_back(node);
+                }
+
+                std::string result;
+                for(auto i = chain.rbegin(); i != chain.rend(); i++) {
+                    if(!result.empty()) {
+                        result.push_back(separator_);
+                    }
+                    result.append(name(*i));
+                }
+                return result;
+            }
+
+            // Node of a path, or `npos` if the tree does not hold it. The children of each directory are binary searched.
+            std::size_t find(std::string_view path) const
+            {
+                std::size_t node = root();
+                std::size_t begin = 0;
+                while(begin < path.size()) {
+                    std::size_t end = std::min(path.find(separator_, begin), path.size());
+                    std::string_view segment = path.substr(begin, end - begin);
+                    begin = end + 1;
+                    if(segment.empty()) {
+                        continue;
+                    }
+
+                    auto first = children_.begin() + nodes_[node].first_child;
+                    auto last = first + nodes_[node].child_count;
+                    auto found = std::lower_bound(first, last, segment, [&](std::size_t child, std::string_view s) {
+                        return name(child) < s;
+                    });
+                    if(found == last || name(*found) != segment) {
+                        return npos;
+                    }
+                    node = *found;
+                }
+                return node;
+            }
+
+            // Ids of the paths inside a directory, sorted. Empty if the tree does not hold the directory.
+            std::vector<std::size_t> idsUnder(std::string_view directory) const
+            {
+                std::vector<std::size_t> ids;
+                std::size_t node = find(directory);
+                if(node == npos) {
+                    return ids;
+                }
+
+                for(std::size_t i = node + 1; i < subtreeEnd(node); i++) {
+                    if(nodes_[i].id != npos) {
+                        ids.push_back(nodes_[i].id);
+                    }
+                }
+                std::sort(ids.begin(), ids.end());
+                return ids;
+            }
+
+            /*
+                Visits the nodes from the top of the tree down.
+
+                Parameters:
+                `visit`: Called with each node and its path. Returns whether to visit what is inside the node.
+            */
+            template<typename Visit>
+            void forEach(Visit visit) const
+            {
+                std::string path;
+                std::vector<std::pair<std::size_t, std::size_t>> open; // End of each open subtree and the length of its path
+                for(std::size_t node = 1; node < nodes_.size();) {
+                    while(!open.empty() && open.back().first <= node) {
+                        path.resize(open.back().second);
+                        open.pop_back();
+                    }
+
+                    std::size_t length = path.size();
+                    if(!path.empty()) {
+                        path.push_back(separator_);
+                    }
+                    path.append(name(node));
+
+                    if(visit(node, static_cast<const std::string&>(path)) && nodes_[node].child_count > 0) {
+                        open.emplace_back(nodes_[node].subtree_end, length);
+                        node++;
+                    } else {
+                        path.resize(length);
+                        node = nodes_[node].subtree_end;
+                    }
+                }
+            }
+
+            // Visits the nodes from the bottom of the tree up, so every node comes after everything inside it
+            template<typename Visit>
+            void forEachBottomUp(Visit visit) const
+            {
+                for(std::size_t node = nodes_.size(); node-- > 1;) {
+                    visit(node);
+                }
+            }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,721 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <queue>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#if defined(_WIN32)
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+    #define VARMATCH_X86_SIMD
+    #include <immintrin.h>
+#endif
+
+namespace varmatch {
+
+    enum class ScanMode {Auto, Scalar, SSE2, AVX2};
+
+    namespace _private {
+
+        inline std::size_t findScalar(const char* data, std::size_t pos, std::size_t end, char a, char b)
+        {
+            while(pos < end && data[pos] != a && data[pos] != b) {
+                pos++;
+            }
+
+            return pos;
+        }
+
+        #if defined(VARMATCH_X86_SIMD)
+            inline std::size_t findSSE2(const char* data, std::size_t pos, std::size_t end, char a, char b)
+            {
+                const __m128i va = _mm_set1_epi8(a);
+                const __m128i vb = _mm_set1_epi8(b);
+                while(end - pos >= 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+                    if(mask != 0) {
+                        return pos + __builtin_ctz(mask);
+                    }
+                    pos += 16;
+                }
+
+                return findScalar(data, pos, end, a, b);
+            }
+
+            __attribute__((target("avx2")))
+            inline std::size_t findAVX2(const char* data, std::size_t pos, std::size_t end, char a, char b)
+            {
+                const __m256i va = _mm256_set1_epi8(a);
+                const __m256i vb = _mm256_set1_epi8(b);
+                while(end - pos >= 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+                    unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+                    if(mask != 0) {
+                        return pos + __builtin_ctz(mask);
+                    }
+                    pos += 32;
+                }
+
+                return findSSE2(data, pos, end, a, b);
+            }
+        #endif
+    }
+
+    /*
+        Checks if the given scan mode can be used on this machine.
+
+        Parameters:
+        `mode`: Scan mode to check.
+    */
+    inline bool isSupported(const ScanMode& mode)
+    {
+        switch(mode) {
+            case ScanMode::Auto:
+            case ScanMode::Scalar:
+                return true;
+        #if defined(VARMATCH_X86_SIMD)
+            case ScanMode::SSE2:
+                return true;
+            case ScanMode::AVX2:
+                return __builtin_cpu_supports("avx2");
+        #endif
+            default:
+                return false;
+        }
+    }
+
+    // Returns the fastest scan mode supported by this machine.
+    inline ScanMode bestScanMode()
+    {
+        static const ScanMode best = isSupported(ScanMode::AVX2) ? ScanMode::AVX2 
+                                   : isSupported(ScanMode::SSE2) ? ScanMode::SSE2 : ScanMode::Scalar;
+        return best;
+    }
+
+    /*
+        Returns the index of the first byte in `data[pos, end)` that is `a` or `b`, or `end` if there is none.
+
+        Parameters:
+        `data`: Bytes to scan.
+        `pos`: Index to start scanning at.
+        `end`: Index to stop scanning at.
+        `a`, `b`: Bytes to find.
+        `mode`: Scanner to use. An unsupported mode falls back to a supported one.
+    */
+    inline std::size_t findAny(const char* data, std::size_t pos, std::size_t end, char a, char b, const ScanMode& mode = ScanMode::Auto)
+    {
+        switch(mode == ScanMode::Auto ? bestScanMode() : mode) {
+        #if defined(VARMATCH_X86_SIMD)
+            case ScanMode::SSE2:
+                return _private::findSSE2(data, pos, end, a, b);
+            case ScanMode::AVX2:
+                if(isSupported(ScanMode::AVX2)) {
+                    return _private::findAVX2(data, pos, end, a, b);
+                }
+                return _private::findSSE2(data, pos, end, a, b);
+        #endif
+            default:
+                return _private::findScalar(data, pos, end, a, b);
+        }
+    }
+
+    /*
+        Destination of replaced output.
+
+        Concrete sinks are `final`, so `Matcher::replace()` calls them directly when their type is known
+        and through the virtual call when only a `Sink&` is at hand.
+    */
+    class Sink {
+        public:
+            virtual ~Sink() = default;
+            virtual void write(const char* data, std::size_t size) = 0;
+    };
+
+    // Appends output to a string.
+    class StringSink final : public Sink {
+        private:
+            std::string& out_;
+
+        public:
+            StringSink(std::string& out) : out_(out) {}
+
+            void write(const char* data, std::size_t size) override
+            {
+                out_.append(data, size);
+            }
+    };
+
+    /*
+        Writes output into a fixed memory region, such as a writable memory mapping.
+        Output that does not fit is dropped and marks the sink as overflowed.
+    */
+    class RegionSink final : public Sink {
+        private:
+            char* data_;
+            std::size_t capacity_;
+            std::size_t size_ = 0;
+            bool overflowed_ = false;
+
+        public:
+            RegionSink(char* data, std::size_t capacity) : data_(data), capacity_(capacity) {}
+
+            void write(const char* data, std::size_t size) override
+            {
+                std::size_t count = std::min(size, capacity_ - size_);
+                std::memcpy(data_ + size_, data, count);
+                size_ += count;
+                overflowed_ = overflowed_ || count < size;
+            }
+
+            // Number of bytes written to the region.
+            std::size_t size() const
+            {
+                return size_;
+            }
+
+            bool overflowed() const
+            {
+                return overflowed_;
+            }
+    };
+
+    /*
+        Writes output to a file descriptor through a fixed buffer, so many small pieces become few system calls.
+        The buffer is flushed when full, on `flush()` and on destruction.
+    */
+    class FileSink final : public Sink {
+        private:
+            int fd_;
+            std::vector<char> buffer_;
+            std::size_t used_ = 0;
+            bool good_ = true;
+
+            void put(const char* data, std::size_t size)
+            {
+                while(size > 0 && good_) {
+                    #if defined(_WIN32)
+                        int count = _write(fd_, data, static_cast<unsigned int>(std::min<std::size_t>(size, 1 << 30)));
+                    #else
+                        ssize_t count = ::write(fd_, data, size);
+                        if(count < 0 && errno == EINTR) {
+                            continue;
+                        }
+                    #endif
+
+                    if(count <= 0) {
+                        good_ = false;
+                        break;
+                    }
+
+                    data += count;
+                    size -= count;
+                }
+            }
+
+        public:
+            FileSink(int fd, std::size_t buffer_size = 64 * 1024) : fd_(fd), buffer_(buffer_size) {}
+            FileSink(const FileSink&) = delete;
+            FileSink& operator=(const FileSink&) = delete;
+
+            ~FileSink()
+            {
+                flush();
+            }
+
+            void write(const char* data, std::size_t size) override
+            {
+                if(used_ + size > buffer_.size()) {
+                    flush();
+
+                    // Pieces as large as the buffer skip it
+                    if(size >= buffer_.size()) {
+                        put(data, size);
+                        return;
+                    }
+                }
+
+                std::memcpy(buffer_.data() + used_, data, size);
+                used_ += size;
+            }
+
+            void flush()
+            {
+                put(buffer_.data(), used_);
+                used_ = 0;
+            }
+
+            // Returns `false` if a write to the file descriptor failed.
+            bool good() const
+            {
+                return good_;
+            }
+    };
+
+    /*
+        A compiled matcher for template variables of the form `prefix + name + suffix`.
+
+        The prefix and suffix are compiled into an Aho-Corasick automaton so that every delimiter
+        occurrence is found in one linear pass, and the variable names are compiled into an
+        open-addressing table that is probed with views into the input. Matching a candidate
+        never allocates. While the automaton is idle, the input is skipped with a vectorized scan for the
+        first byte of a delimiter, so stretches without variables are copied as whole blocks.
+
+        The output is identical to the original `helper::replaceVariables()`:
+        - A prefix followed by a suffix within the length of the longest name is a variable.
+          It is replaced by its value, or removed if the name is unknown.
+        - A prefix with no suffix in range is kept as is and scanning resumes after it.
+    */
+    class Matcher {
+        private:
+            enum : unsigned char {PrefixEnd = 1, SuffixEnd = 2};
+
+            std::string prefix_;
+            std::string suffix_;
+            std::vector<std::string> names_;
+            std::vector<std::string> values_;
+            std::vector<int> slots_; // Indices into `names_`, -1 for an empty slot
+            std::size_t max_name_size_ = 0;
+            ScanMode scan_mode_ = ScanMode::Scalar;
+            std::vector<int> delta_; // Transition table of the automaton (states x 256)
+            std::vector<unsigned char> output_; // `PrefixEnd`/`SuffixEnd` flags of each state
+
+            void compileNames()
+            {
+                std::size_t capacity = 8;
+                while(capacity < names_.size() * 2) {
+                    capacity *= 2;
+                }
+
+                slots_.assign(capacity, -1);
+                for(std::size_t i = 0; i < names_.size(); i++) {
+                    std::size_t slot = std::hash<std::string_view>{}(names_[i]) & (capacity - 1);
+                    while(slots_[slot] != -1) {
+                        slot = (slot + 1) & (capacity - 1);
+                    }
+                    slots_[slot] = static_cast<int>(i);
+
+                    if(names_[i].size() > max_name_size_) {
+                        max_name_size_ = names_[i].size();
+                    }
+                }
+            }
+
+            void compileDelimiters()
+            {
+                // Build the trie of both delimiters
+                delta_.assign(256, -1);
+                output_.assign(1, 0);
+
+                const std::string* delimiters[] = {&prefix_, &suffix_};
+                const unsigned char flags[] = {PrefixEnd, SuffixEnd};
+                for(int d = 0; d < 2; d++) {
+                    int state = 0;
+                    for(unsigned char ch : *delimiters[d]) {
+                        if(delta_[state * 256 + ch] == -1) {
+                            delta_[state * 256 + ch] = output_.size();
+                            delta_.resize(delta_.size() + 256, -1);
+                            output_.push_back(0);
+                        }
+                        state = delta_[state * 256 + ch];
+                    }
+                    output_[state] |= flags[d];
+                }
+
+                // Turn the trie into a full transition table using the failure links
+                std::vector<int> fail(output_.size(), 0);
+                std::queue<int> q;
+                for(int ch = 0; ch < 256; ch++) {
+                    int& next = delta_[ch];
+                    if(next == -1) {
+                        next = 0;
+                    } else {
+                        q.push(next);
+                    }
+                }
+
+                while(!q.empty()) {
+                    int state = q.front();
+                    q.pop();
+                    output_[state] |= output_[fail[state]];
+
+                    for(int ch = 0; ch < 256; ch++) {
+                        int& next = delta_[state * 256 + ch];
+                        if(next == -1) {
+                            next = delta_[fail[state] * 256 + ch];
+                        } else {
+                            fail[next] = delta_[fail[state] * 256 + ch];
+                            q.push(next);
+                        }
+                    }
+                }
+            }
+
+        public:
+            static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+            Matcher() {}
+
+            Matcher(const std::unordered_map<std::string, std::string>& keyval, const std::string& prefix, const std::string& suffix,
+                    const ScanMode& scan_mode = ScanMode::Auto)
+                    : prefix_(prefix), suffix_(suffix), scan_mode_(scan_mode == ScanMode::Auto ? bestScanMode() : scan_mode)
+            {
+                for(const auto& i : keyval) {
+                    names_.push_back(i.first);
+                    values_.push_back(i.second);
+                }
+
+                compileNames();
+
+                if(enabled()) {
+                    compileDelimiters();
+                }
+            }
+
+            // Returns `false` when the prefix or suffix is empty, in which case the input is never changed.
+            bool enabled() const
+            {
+                return !prefix_.empty() && !suffix_.empty();
+            }
+
+            const std::string& prefix() const
+            {
+                return prefix_;
+            }
+
+            const std::string& suffix() const
+            {
+                return suffix_;
+            }
+
+            // Returns the length of the longest variable name, which bounds how far a suffix is searched for.
+            std::size_t maxNameSize() const
+            {
+                return max_name_size_;
+            }
+
+            const ScanMode& scanMode() const
+            {
+                return scan_mode_;
+            }
+
+            /*
+                Returns the index of the variable with the given name, or `npos` if it is unknown.
+
+                Parameters:
+                `name`: Name of the variable.
+            */
+            std::size_t find(std::string_view name) const
+            {
+                if(slots_.empty()) {
+                    return npos;
+                }
+
+                std::size_t mask = slots_.size() - 1;
+                std::size_t slot = std::hash<std::string_view>{}(name) & mask;
+                while(slots_[slot] != -1) {
+                    if(names_[slots_[slot]] == name) {
+                        return slots_[slot];
+                    }
+                    slot = (slot + 1) & mask;
+                }
+
+                return npos;
+            }
+
+            const std::string& value(std::size_t id) const
+            {
+                return values_[id];
+            }
+
+            /*
+                Finds the variables of `data` and calls `on_match(begin, end, id)` for each of them in order,
+                where `data[begin, end)` is the whole variable and `id` is the index of its name or `npos` if
+                the name is unknown. Scanning stops early when `on_match` returns `false`.
+                Returns the number of bytes of `data` that were decided.
+
+                Parameters:
+                `data`: Input bytes.
+                `size`: Number of input bytes.
+                `on_match`: Callback for each variable.
+                `final`: Set to `false` if more input follows `data`. Bytes that cannot be decided without
+                         the following input are then left undecided and have to be passed again.
+            */
+            template<typename Callback>
+            std::size_t scan(const char* data, std::size_t size, Callback&& on_match, bool final = true) const
+            {
+                if(!enabled()) {
+                    return size;
+                }
+
+                const std::size_t prefix_size = prefix_.size();
+                const std::size_t suffix_size = suffix_.size();
+
+                int state = 0;
+                std::size_t pos = 0; // Number of bytes fed to the automaton
+                std::size_t i = 0; // Start of the bytes that are not yet decided
+                // Prefix starts found ahead while searching for a suffix. Kept on the stack so scanning never allocates;
+                // prefixes past a full buffer are found again by scanning from the first of them.
+                std::size_t prefixes[32];
+                std::size_t prefix_count = 0;
+                std::size_t prefix_head = 0;
+                std::size_t unrecorded = npos; // Start of the first prefix that did not fit
+                std::size_t pending_suffix = npos; // Suffix start found ahead of the last search window
+
+                while(true) {
+                    // Find the next prefix that starts at or after `i`
+                    std::size_t k = npos;
+                    while(prefix_head < prefix_count && prefixes[prefix_head] < i) {
+                        prefix_head++;
+                    }
+
+                    if(prefix_head < prefix_count) {
+                        k = prefixes[prefix_head++];
+                    } else {
+                        prefix_count = 0;
+                        prefix_head = 0;
+                        if(unrecorded != npos) {
+                            pos = std::max(i, unrecorded);
+                            state = 0;
+                            unrecorded = npos;
+                        }
+                        while(pos < size) {
+                            if(state == 0) {
+                                pos = findAny(data, pos, size, prefix_[0], prefix_[0], scan_mode_);
+                                if(pos >= size) {
+                                    break;
+                                }
+                            }
+
+                            state = delta_[state * 256 + static_cast<unsigned char>(data[pos++])];
+                            if((output_[state] & PrefixEnd) && pos - prefix_size >= i) {
+                                k = pos - prefix_size;
+                                break;
+                            }
+                        }
+                    }
+
+                    if(k == npos) {
+                        // Keep the bytes that may be the start of a prefix split by the end of `data`
+                        if(!final) {
+                            return size - std::min(size - i, prefix_size - 1);
+                        }
+                        return size;
+                    }
+
+                    // Find the first suffix that starts within the longest name after the prefix
+                    std::size_t first = k + prefix_size;
+                    std::size_t last = first + max_name_size_;
+                    std::size_t j = npos;
+                    bool decided = true;
+
+                    if(pending_suffix != npos && pending_suffix >= first) {
+                        j = pending_suffix <= last ? pending_suffix : npos;
+                    } else {
+                        pending_suffix = npos;
+                        while(pos < last + suffix_size) {
+                            if(state == 0) {
+                                pos = findAny(data, pos, std::min(size, last + suffix_size), prefix_[0], suffix_[0], scan_mode_);
+                                if(pos >= last + suffix_size) {
+                                    break;
+                                }
+                            }
+
+                            if(pos >= size) {
+                                decided = final;
+                                break;
+                            }
+
+                            state = delta_[state * 256 + static_cast<unsigned char>(data[pos++])];
+                            unsigned char flags = output_[state];
+                            if((flags & PrefixEnd) && pos - prefix_size > k) {
+                                if(prefix_count < sizeof(prefixes) / sizeof(prefixes[0])) {
+                                    prefixes[prefix_count++] = pos - prefix_size;
+                                } else if(unrecorded == npos) {
+                                    unrecorded = pos - prefix_size;
+                                }
+                            }
+
+                            if((flags & SuffixEnd) && pos - suffix_size >= first) {
+                                if(pos - suffix_size <= last) {
+                                    j = pos - suffix_size;
+                                } else {
+                                    pending_suffix = pos - suffix_size;
+                                }
+                                break;
+                            }
+                        }
+                    }
+
+                    if(!decided) {
+                        return k;
+                    }
+
+                    if(j != npos) {
+                        i = j + suffix_size;
+                        if(!on_match(k, i, find(std::string_view(data + first, j - first)))) {
+                            return i;
+                        }
+                    } else {
+                        // A prefix without a suffix is kept as is
+                        i = first;
+                    }
+                }
+            }
+
+            /*
+                Returns the start of the first variable in `data`, or `npos` if there is none.
+                Data without variables is never changed by `replace()`.
+
+                Parameters:
+                `data`: Input bytes.
+                `size`: Number of input bytes.
+            */
+            std::size_t firstVariable(const char* data, std::size_t size) const
+            {
+                std::size_t first = npos;
+                scan(data, size, [&first](std::size_t begin, std::size_t, std::size_t) {
+                    first = begin;
+                    return false;
+                });
+
+                return first;
+            }
+
+            /*
+                Replaces the variables of `input` and writes the result to `sink`.
+                Returns the number of bytes of `input` that were consumed. Never allocates.
+
+                Parameters:
+                `input`: Input bytes.
+                `sink`: Output to write the result to. Any type with `write(const char*, std::size_t)`.
+                `final`: Set to `false` if more input follows `input`. Bytes that cannot be decided without
+                         the following input are then left unconsumed and have to be passed again.
+            */
+            template<typename SinkType>
+            std::size_t replace(std::string_view input, SinkType& sink, bool final = true) const
+            {
+                const char* data = input.data();
+                std::size_t written = 0;
+                std::size_t consumed = scan(data, input.size(), [&](std::size_t begin, std::size_t end, std::size_t id) {
+                    sink.write(data + written, begin - written);
+                    if(id != npos) {
+                        sink.write(values_[id].data(), values_[id].size());
+                    }
+                    written = end;
+                    return true;
+                }, final);
+
+                sink.write(data + written, consumed - written);
+                return consumed;
+            }
+
+            /*
+                Replaces the variables of `data` and appends the result to `out`.
+                Returns the number of bytes of `data` that were consumed.
+
+                Parameters:
+                `data`: Input bytes.
+                `size`: Number of input bytes.
+                `out`: String to append the result to.
+                `final`: Set to `false` if more input follows `data`.
+            */
+            std::size_t replace(const char* data, std::size_t size, std::string& out, bool final = true) const
+            {
+                StringSink sink(out);
+                return replace(std::string_view(data, size), sink, final);
+            }
+
+            /*
+                Replaces all variables in a given string.
+
+                Parameters:
+                `str`: Given string.
+            */
+            std::string replace(const std::string& str) const
+            {
+                std::string result;
+                result.reserve(str.size());
+                replace(str.data(), str.size(), result);
+                return result;
+            }
+    };
+
+    /*
+        Replaces variables in input that arrives in chunks.
+
+        Bytes that may belong to a variable split by the end of a chunk are carried over to the next
+        chunk, so the memory used is bounded by the chunk size plus the length of the longest variable.
+    */
+    class Stream {
+        private:
+            const Matcher& matcher_;
+            std::string pending_;
+
+        public:
+            Stream(const Matcher& matcher) : matcher_(matcher) {}
+
+            /*
+                Replaces the variables of the next chunk and writes the decided output to `sink`.
+
+                Parameters:
+                `chunk`: Bytes of the chunk.
+                `sink`: Output to write the result to.
+            */
+            template<typename SinkType>
+            void write(std::string_view chunk, SinkType& sink)
+            {
+                if(pending_.empty()) {
+                    std::size_t consumed = matcher_.replace(chunk, sink, false);
+                    pending_.assign(chunk.data() + consumed, chunk.size() - consumed);
+                    return;
+                }
+
+                pending_.append(chunk.data(), chunk.size());
+                std::size_t consumed = matcher_.replace(pending_, sink, false);
+                pending_.erase(0, consumed);
+            }
+
+            /*
+                Flushes the carried over bytes once the input has ended.
+
+                Parameters:
+                `sink`: Output to write the result to.
+            */
+            template<typename SinkType>
+            void finish(SinkType& sink)
+            {
+                matcher_.replace(pending_, sink, true);
+                pending_.clear();
+            }
+
+            /*
+                Replaces the variables of the next chunk and appends the decided output to `out`.
+
+                Parameters:
+                `data`: Bytes of the chunk.
+                `size`: Number of bytes in the chunk.
+                `out`: String to append the result to.
+            */
+            void write(const char* data, std::size_t size, std::string& out)
+            {
+                StringSink sink(out);
+                write(std::string_view(data, size), sink);
+            }
+
+            void finish(std::string& out)
+            {
+                StringSink sink(out);
+                finish(sink);
+            }
+    };
+}
\ No newline at end of file
@@ -13,9 +13,9 @@ using ordered_json = nlohmann::ordered_json;
 namespace path = os::path;
 namespace fs = std::filesystem;
 
-void initTemplate(const std::string& template_to_init, const std::set<std::string>& paths, const std::string& template_files_container_name, 
+void initTemplate(const std::string& template_to_init, const pathtable::PathTable& paths, const std::string& template_files_container_name, 
                   const std::string& path_to_init_template_to, const std::unordered_map<std::string, std::string>& keyval,
-                  bool force_overwrite)
+                  bool force_overwrite, helper::LinkMode link_mode)
 {
     if(!path::exists(template_to_init)) {
         std::cout << "[ERROR] Template \"" << path::filename(template_to_init) << "\" does not exist" << std::endl;
@@ -35,111 +35,175 @@ void initTemplate(const std::string& template_to_init, const std::set<std::strin
         return;
     }
 
-    path::copy(template_to_init, paths, path_to_init_template_to, path::CopyOption::OverwriteAll);
-
-    // Remove ctemplate container from the initialized template
-    path::remove(path::joinPath(path_to_init_template_to, template_files_container_name));
+    // The template replaces everything inside the destination. Where possible it is made in a directory next to
+    // the destination and swapped in at the end, so the destination never holds a half-initialized template.
+    // Replaced files are moved to the trash of the template directory and deleted in the background.
+    std::string trash_path = path::joinPath(fs::path(template_to_init).parent_path().string(), global::trash_name);
+    std::string staging_path = path::makeStagingDirectory(path_to_init_template_to).string();
+    if(staging_path.empty() && path::exists(path_to_init_template_to)) {
+        bool trashed = false;
+        for(const auto& entry : fs::directory_iterator(path_to_init_template_to)) {
+            if(!path::moveToTrash(entry.path(), trash_path).empty()) {
+                trashed = true;
+            } else {
+                path::remove(entry.path());
+            }
+        }
 
-    // End function early if there are no variables to initialize
-    if(keyval.empty()) {
-        std::cout << "[SUCCESS] Template \"" << path::filename(template_to_init) << "\" has been initialized." << std::endl;
-        return;
+        if(trashed) {
+            path::emptyTrashInBackground(trash_path);
+        }
     }
 
-    std::string container_path = path::joinPath(template_to_init, template_files_container_name);
-    std::string cache_path = path::joinPath(container_path, global::cache_container_name);
-    std::string pattern_chars = "*?";
-
-    // Split patterns and non-patterns
-    std::pair<std::set<std::string>, std::unordered_set<std::string>> files_include = helper::splitPatterns(
-        helper::jsonListToSet(vars.at("searchPaths").at("files").at("include")), pattern_chars
-    );
-
-    std::pair<std::set<std::string>, std::unordered_set<std::string>> files_exclude = helper::splitPatterns(
-        helper::jsonListToSet(vars.at("searchPaths").at("files").at("exclude")), pattern_chars
-    );
+    std::string init_path = staging_path.empty() ? path_to_init_template_to : staging_path;
+    auto swapInStagedTemplate = [&]() {
+        if(!staging_path.empty()) {
+            path::replaceDirectory(staging_path, path_to_init_template_to, trash_path);
+            staging_path.clear();
+        }
+    };
 
-    std::pair<std::set<std::string>, std::unordered_set<std::string>> filenames_include = helper::splitPatterns(
-        helper::jsonListToSet(vars.at("searchPaths").at("filenames").at("include")), pattern_chars
-    );
+    // A staged template that fails halfway is removed, since nothing else would collect it
+    try {
+        // Leave the ctemplate container out of the initialized template
+        pathtable::PathTable template_paths;
+        for(const auto& i : paths) {
+            if(*fs::path(i).begin() != template_files_container_name) {
+                template_paths.push_back(i);
+            }
+        }
 
-    std::pair<std::set<std::string>, std::unordered_set<std::string>> filenames_exclude = helper::splitPatterns(
-        helper::jsonListToSet(vars.at("searchPaths").at("filenames").at("exclude")), pattern_chars
-    );
+        // Files to link into the template instead of copying
+        std::unordered_map<std::string, helper::LinkMode> link_modes = helper::getLinkModes(template_paths, vars.value("linkPaths", json::object()), link_mode);
+        std::string manifest_file = path::joinPath(init_path, global::manifest_name);
 
-    std::string var_prefix = vars.at("variablePrefix");
-    std::string var_suffix = vars.at("variableSuffix");
+        // End function early if there are no variables to initialize
+        if(keyval.empty()) {
+            helper::copyTemplateFiles(template_to_init, template_paths, init_path, link_modes, global::thread_count);
+            helper::writeLinkManifest(manifest_file, template_to_init, init_path, link_modes, {}, varmatch::Matcher({}, "", ""));
+            swapInStagedTemplate();
+            std::cout << "[SUCCESS] Template \"" << path::filename(template_to_init) << "\" has been initialized." << std::endl;
+            return;
+        }
 
-    std::set<std::string> included_files;
-    std::set<std::string> included_filenames;
+        std::string container_path = path::joinPath(template_to_init, template_files_container_name);
+        std::string cache_path = path::joinPath(container_path, global::cache_container_name);
+        std::string pattern_chars = "*?";
 
-    bool cache_exist = path::exists(path::joinPath(cache_path, "search_paths.json")) && path::exists(path::joinPath(cache_path, "included_search_paths.json"));
-    if(cache_exist) {
-        json search_paths_cache = helper::readJsonFromFile(path::joinPath(cache_path, "search_paths.json"));
-        
-        std::pair<std::set<std::string>, std::unordered_set<std::string>> files_include_cache = helper::splitPatterns(
-            helper::jsonListToSet(search_paths_cache.at("files").at("include")), pattern_chars
+        // Split patterns and non-patterns
+        std::pair<std::set<std::string>, std::unordered_set<std::string>> files_include = helper::splitPatterns(
+            helper::jsonListToSet(vars.at("searchPaths").at("files").at("include")), pattern_chars
         );
 
-        std::pair<std::set<std::string>, std::unordered_set<std::string>> files_exclude_cache = helper::splitPatterns(
-            helper::jsonListToSet(search_paths_cache.at("files").at("exclude")), pattern_chars
+        std::pair<std::set<std::string>, std::unordered_set<std::string>> files_exclude = helper::splitPatterns(
+            helper::jsonListToSet(vars.at("searchPaths").at("files").at("exclude")), pattern_chars
         );
 
-        std::pair<std::set<std::string>, std::unordered_set<std::string>> filenames_include_cache = helper::splitPatterns(
-            helper::jsonListToSet(search_paths_cache.at("filenames").at("include")), pattern_chars
+        std::pair<std::set<std::string>, std::unordered_set<std::string>> filenames_include = helper::splitPatterns(
+            helper::jsonListToSet(vars.at("searchPaths").at("filenames").at("include")), pattern_chars
         );
 
-        std::pair<std::set<std::string>, std::unordered_set<std::string>> filenames_exclude_cache = helper::splitPatterns(
-            helper::jsonListToSet(search_paths_cache.at("filenames").at("exclude")), pattern_chars
+        std::pair<std::set<std::string>, std::unordered_set<std::string>> filenames_exclude = helper::splitPatterns(
+            helper::jsonListToSet(vars.at("searchPaths").at("filenames").at("exclude")), pattern_chars
         );
 
-        if(files_include == files_include_cache && files_exclude == files_exclude_cache &&
-           filenames_include == filenames_include_cache && filenames_exclude == filenames_exclude_cache) {
+        std::string var_prefix = vars.at("variablePrefix");
+        std::string var_suffix = vars.at("variableSuffix");
+
+        pathtable::PathTable included_files;
+        pathtable::PathTable included_filenames;
+
+        bool cache_exist = path::exists(path::joinPath(cache_path, "search_paths.json")) && path::exists(path::joinPath(cache_path, "included_search_paths.json"));
+        if(cache_exist) {
+            json search_paths_cache = helper::readJsonFromFile(path::joinPath(cache_path, "search_paths.json"));
+        
+            std::pair<std::set<std::string>, std::unordered_set<std::string>> files_include_cache = helper::splitPatterns(
+                helper::jsonListToSet(search_paths_cache.at("files").at("include")), pattern_chars
+            );
+
+            std::pair<std::set<std::string>, std::unordered_set<std::string>> files_exclude_cache = helper::splitPatterns(
+                helper::jsonListToSet(search_paths_cache.at("files").at("exclude")), pattern_chars
+            );
+
+            std::pair<std::set<std::string>, std::unordered_set<std::string>> filenames_include_cache = helper::splitPatterns(
+                helper::jsonListToSet(search_paths_cache.at("filenames").at("include")), pattern_chars
+            );
+
+            std::pair<std::set<std::string>, std::unordered_set<std::string>> filenames_exclude_cache = helper::splitPatterns(
+                helper::jsonListToSet(search_paths_cache.at("filenames").at("exclude")), pattern_chars
+            );
+
+            if(files_include == files_include_cache && files_exclude == files_exclude_cache &&
+               filenames_include == filenames_include_cache && filenames_exclude == filenames_exclude_cache) {
             
-            json paths = helper::readJsonFromFile(path::joinPath(cache_path, "included_search_paths.json"));
-            included_files = helper::jsonListToSet(paths.at("files"));
-            included_filenames = helper::jsonListToSet(paths.at("filenames"));
+                json paths = helper::readJsonFromFile(path::joinPath(cache_path, "included_search_paths.json"));
+                included_files = helper::jsonListToSet(paths.at("files"));
+                included_filenames = helper::jsonListToSet(paths.at("filenames"));
+            } else {
+                included_files = helper::matchPaths(paths, helper::PathFilter(files_include, files_exclude));
+                included_filenames = helper::matchPaths(paths, helper::PathFilter(filenames_include, filenames_exclude));
+                helper::makeCacheForSearchPaths(cache_path, vars.at("searchPaths"), included_files, included_filenames);
+            }
+        
         } else {
-            included_files = helper::matchPaths(paths, files_include, files_exclude);
-            included_filenames = helper::matchPaths(paths, filenames_include, filenames_exclude);
+            included_files = helper::matchPaths(paths, helper::PathFilter(files_include, files_exclude));
+            included_filenames = helper::matchPaths(paths, helper::PathFilter(filenames_include, filenames_exclude));
             helper::makeCacheForSearchPaths(cache_path, vars.at("searchPaths"), included_files, included_filenames);
         }
-        
-    } else {
-        included_files = helper::matchPaths(paths, files_include, files_exclude);
-        included_filenames = helper::matchPaths(paths, filenames_include, filenames_exclude);
-        helper::makeCacheForSearchPaths(cache_path, vars.at("searchPaths"), included_files, included_filenames);
-    }
 
-    helper::replaceVariablesInAllFiles(path_to_init_template_to, included_files, keyval, var_prefix, var_suffix);
-    helper::replaceVariablesInAllFilenames(path_to_init_template_to, included_filenames, keyval, var_prefix, var_suffix);
+        // Compile the variables once for every file and filename of the template
+        varmatch::Matcher matcher(keyval, var_prefix, var_suffix);
+
+        // Reuse the variable positions found in previous initializations
+        std::string plan_file = path::joinPath(cache_path, "substitution_plan.json");
+        helper::SubstitutionPlan plan(matcher, vars.value("maxFileSize", std::uintmax_t(0)));
+        plan.load(plan_file);
+
+        // Copy every file once, replacing the variables of the included files on the way
+        int rewritten = helper::copyTemplateFiles(template_to_init, template_paths, init_path, included_files, plan, 
+                                                  link_modes, global::thread_count);
 
-    std::cout << "[SUCCESS] Template \"" << path::filename(template_to_init) << "\" has been initialized." << std::endl;
+        if(plan.changed()) {
+            plan.save(plan_file);
+        }
+        helper::replaceVariablesInAllFilenames(init_path, included_filenames, matcher);
+        helper::writeLinkManifest(manifest_file, template_to_init, init_path, link_modes, included_filenames, matcher);
+        swapInStagedTemplate();
+
+        std::cout << "[SUCCESS] Template \"" << path::filename(template_to_init) << "\" has been initialized." << std::endl;
+        std::cout << "[INFO] Replaced variables in " << rewritten << " of " << included_files.size() << " searched path(s)." << std::endl;
+    } catch(...) {
+        if(!staging_path.empty()) {
+            std::error_code ec;
+            fs::remove_all(staging_path, ec);
+        }
+        throw;
+    }
 }
 
-void initTemplate(const std::string& template_dir, const std::string& template_name, const std::set<std::string>& paths, const std::string& template_files_container_name, 
+void initTemplate(const std::string& template_dir, const std::string& template_name, const pathtable::PathTable& paths, const std::string& template_files_container_name, 
                   const std::string& path_to_init_template_to, const std::unordered_map<std::string, std::string>& keyval,
-                  bool force_overwrite)
+                  bool force_overwrite, helper::LinkMode link_mode)
 {
     return initTemplate(path::joinPath(template_dir, template_name), paths, template_files_container_name,
-                        path_to_init_template_to, keyval, force_overwrite);
+                        path_to_init_template_to, keyval, force_overwrite, link_mode);
 }
 
 void initTemplate(const std::string& template_to_init, const std::string& template_files_container_name, 
                   const std::string& path_to_init_template_to, const std::unordered_map<std::string, std::string>& keyval,
-                  bool force_overwrite)
+                  bool force_overwrite, helper::LinkMode link_mode)
 {
-    return initTemplate(template_to_init, helper::getPaths(template_to_init, template_to_init), template_files_container_name, 
-                        path_to_init_template_to, keyval, force_overwrite);
+    return initTemplate(template_to_init, helper::getPathTable(template_to_init, global::thread_count), template_files_container_name, 
+                        path_to_init_template_to, keyval, force_overwrite, link_mode);
 }
 
 void initTemplate(const std::string& template_dir, const std::string& template_name,
                   const std::string& template_files_container_name, const std::string& path_to_init_template_to, 
-                  const std::unordered_map<std::string, std::string>& keyval, bool force_overwrite)
+                  const std::unordered_map<std::string, std::string>& keyval, bool force_overwrite, helper::LinkMode link_mode)
 {
     std::string template_to_init = path::joinPath(template_dir, template_name);
-    return initTemplate(template_to_init, helper::getPaths(template_to_init, template_to_init), 
-                        template_files_container_name, path_to_init_template_to, keyval, force_overwrite);
+    return initTemplate(template_to_init, helper::getPathTable(template_to_init, global::thread_count), 
+                        template_files_container_name, path_to_init_template_to, keyval, force_overwrite, link_mode);
 }
 
 void addTemplate(const std::string& template_dir, const std::string& path_to_add, const std::string& name,
@@ -194,15 +258,26 @@ void addTemplate(const std::string& template_dir, const std::string& path_to_add
 
 void removeTemplates(const std::string& template_dir, const std::vector<std::string>& templates)
 {
+    // Templates are moved to the trash right away and deleted in the background
+    std::string trash_path = path::joinPath(template_dir, global::trash_name);
+    bool trashed = false;
     std::vector<std::string> deleted;
     for(int i = 0; i < templates.size(); i++) {
         std::string template_path = path::joinPath(template_dir, templates[i]);
         if(path::exists(template_path)) {
-            path::remove(template_path);
+            if(!path::moveToTrash(template_path, trash_path).empty()) {
+                trashed = true;
+            } else {
+                path::remove(template_path);
+            }
             deleted.push_back(templates[i]);
         }
     }
 
+    if(trashed) {
+        path::emptyTrashInBackground(trash_path);
+    }
+
     if(!deleted.empty()) {
         std::cout << "[SUCCESS] Templates ";
         for(int i = 0; i < deleted.size(); i++) {
@@ -215,14 +290,20 @@ void removeTemplates(const std::string& template_dir, const std::vector<std::str
     }
 }
 
-void listTemplates(const std::string& template_dir, const std::string& container_name)
+void collectGarbage(const std::string& template_dir)
 {
-    // If the template directory is empty
-    if(path::isEmpty(template_dir)) {
-        std::cout << "[ERROR] No templates found" << std::endl;
-        return;
-    }
+    // Finish deleting whatever was left in the trash, such as when the background removal was interrupted
+    std::string trash_path = path::joinPath(template_dir, global::trash_name);
+    std::size_t removed = path::emptyTrash(trash_path);
+
+    std::error_code ec;
+    fs::remove(trash_path, ec);
+
+    std::cout << "[SUCCESS] Removed " << removed << " path(s) from the trash" << std::endl;
+}
 
+void listTemplates(const std::string& template_dir, const std::string& container_name)
+{
     std::vector<std::vector<std::string>> v = {{"Name", "Author", "Description"}}; // A table  
 
     // Iterate through the whole template directory
@@ -263,6 +344,12 @@ void listTemplates(const std::string& template_dir, const std::string& container
         v.push_back(temp);
     }
 
+    // If no templates were found, ignoring hidden entries such as the trash directory
+    if(v.size() == 1) {
+        std::cout << "[ERROR] No templates found" << std::endl;
+        return;
+    }
+
     // Format the outputted text
     format::Table table(v, '-', '|', 3);
     table.print();
@@ -17,7 +17,10 @@ namespace global {
 
     json app_config = {
         {"templateDirectory", path::joinPath(path::sourcePath(), "templates")},
-        {"containerName", ".ctemplate"}
+        {"containerName", ".ctemplate"},
+        {"reflink", "auto"},
+        {"ioBackend", "threads"},
+        {"ioQueueDepth", "64"}
     };
 
     json template_info_config = {
@@ -44,4 +47,17 @@ namespace global {
     )");
     
     std::string cache_container_name = ".cache";
+
+    // Lists the files of an initialized project that are links into its template
+    std::string manifest_name = ".ctemplate-manifest.json";
+
+    // Directory in the template directory where removed paths wait to be deleted
+    std::string trash_name = ".ctemplate-trash";
+
+    // Files larger than this are substituted in chunks instead of being read whole
+    std::uintmax_t stream_threshold = 16 * 1024 * 1024;
+    std::size_t stream_chunk_size = 256 * 1024;
+
+    // Number of threads used to copy and substitute files (0 to use every hardware thread)
+    unsigned int thread_count = 0;
 }
\ No newline at end of file
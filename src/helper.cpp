@@ -3,8 +3,12 @@
 #include "fmatch.hpp"
 #include "format.hpp"
 #include "global.hpp"
+#include "parallel.hpp"
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
 #include <unordered_set>
 
 using json = nlohmann::json;
@@ -118,12 +122,8 @@ namespace helper {
     */
     std::string readTextFromFile(const std::string& file_path)
     {
-        std::ifstream file(file_path);
-        std::stringstream ss;
-        ss << file.rdbuf();
-        file.close();
-
-        return ss.str();
+        os::MappedFile file(file_path);
+        return std::string(file.data(), file.size());
     }
 
     /*
@@ -354,6 +354,84 @@ namespace helper {
         return true;
     }
 
+    /*
+        Guesses if the given bytes are binary by sniffing their first block.
+        They are binary if the block has a NUL byte or if more than a tenth of it are control characters.
+        Bytes from 0x80 up are not counted whether or not they are valid UTF-8, since text in legacy
+        encodings such as CP1251, KOI8-R or Shift-JIS is mostly made of them.
+
+        Parameters:
+        `data`: Bytes to check.
+        `size`: Number of bytes.
+    */
+    bool isBinaryData(const char* data, std::size_t size)
+    {
+        std::size_t block = std::min<std::size_t>(size, 8192);
+        std::size_t suspicious = 0;
+
+        for(std::size_t i = 0; i < block; i++) {
+            unsigned char ch = data[i];
+            if(ch == 0) {
+                return true;
+            }
+
+            if(ch < 0x20 && ch != '\t' && ch != '\n' && ch != '\r' && ch != '\f' && ch != '\b' && ch != 0x1b) {
+                suspicious++;
+            }
+        }
+
+        return suspicious * 10 > block;
+    }
+
+    /*
+        Replaces all variables in a given string.
+
+        Parameters:
+        `str`: Given string.
+        `matcher`: Compiled variables, prefix and suffix.
+    */
+    std::string replaceVariables(const std::string& str, const varmatch::Matcher& matcher)
+    {
+        std::string result;
+        result.reserve(str.size());
+        varmatch::StringSink sink(result);
+        replaceVariables(std::string_view(str), matcher, sink);
+        return result;
+    }
+
+    /*
+        Replaces all variables in a given string and writes the result to a sink.
+        Does not allocate, so it can be used for strings that are not owned such as memory mappings.
+
+        Parameters:
+        `str`: Given string.
+        `matcher`: Compiled variables, prefix and suffix.
+        `sink`: Output to write the result to. (E.g. `varmatch::StringSink`, `varmatch::FileSink` or `varmatch::RegionSink`)
+    */
+    void replaceVariables(std::string_view str, const varmatch::Matcher& matcher, varmatch::Sink& sink)
+    {
+        matcher.replace(str, sink);
+    }
+
+    /*
+        Replaces all variables in a string split into chunks and writes the result to a sink.
+        Variables may span the boundaries of the chunks.
+
+        Parameters:
+        `chunks`: Pieces of the string in order.
+        `matcher`: Compiled variables, prefix and suffix.
+        `sink`: Output to write the result to.
+    */
+    void replaceVariables(const std::vector<std::string_view>& chunks, const varmatch::Matcher& matcher, varmatch::Sink& sink)
+    {
+        varmatch::Stream stream(matcher);
+        for(const auto& i : chunks) {
+            stream.write(i, sink);
+        }
+
+        stream.finish(sink);
+    }
+
     /*
         Replaces all variables in a given string.
 
@@ -367,63 +445,182 @@ namespace helper {
                                 const std::unordered_map<std::string, std::string>& keyval, 
                                 const std::string& prefix, const std::string& suffix)
     {
-        if(prefix.empty() || suffix.empty()) {
-            return str;
+        return replaceVariables(str, varmatch::Matcher(keyval, prefix, suffix));
+    }
+
+    /*
+        Replaces all variables read from a stream in fixed-size chunks.
+
+        Parameters:
+        `in`: Stream to read from.
+        `out`: Stream to write the result to.
+        `matcher`: Compiled variables, prefix and suffix.
+        `chunk_size`: Number of bytes to read at a time.
+    */
+    void replaceVariablesInStream(std::istream& in, std::ostream& out, const varmatch::Matcher& matcher, std::size_t chunk_size)
+    {
+        std::vector<char> chunk(chunk_size);
+        std::string result;
+        varmatch::Stream stream(matcher);
+
+        while(in) {
+            in.read(chunk.data(), chunk.size());
+            std::streamsize count = in.gcount();
+            if(count <= 0) {
+                break;
+            }
+
+            stream.write(chunk.data(), count, result);
+            out.write(result.data(), result.size());
+            result.clear();
         }
 
-        int max_var_size = 0;
-        for(const auto& i : keyval) {
-            if(i.first.size() > max_var_size) {
-                max_var_size = i.first.size();
-            }
-        }
-
-        std::string new_str;
-
-        // iterate through "str" until prefix is found
-        for(int i = 0; i < str.size(); i++) {
-            // check if current character is equivalent to the first character of prefix then check if it is the prefix itself
-            if(str[i] == prefix[0] && str.substr(i, prefix.size()) == prefix) {
-                std::string var;
-                int j = i + prefix.size(); // skip the prefix
-                int counter = 0;
-                bool has_suffix = false;
-
-                while(j < str.size() && counter <= max_var_size) {
-                    // check if the current character is equivalent to the first character of suffix 
-                    // then check if it is the suffix itself
-                    if(str[j] == suffix[0] && str.substr(j, suffix.size()) == suffix) {
-                        has_suffix = true;
-                        break;
-                    }
-                    var.push_back(str[j]);
-                    j++;
-                    counter++;
-                }
+        stream.finish(result);
+        out.write(result.data(), result.size());
+    }
 
-                // if the variable is in keyval then append it to new_str
-                if(has_suffix && keyval.count(var) > 0) {
-                    new_str.append(keyval.at(var));
-                }
+    /*
+        Replaces all variables in a buffer and writes the result to a stream in fixed-size chunks.
+
+        Parameters:
+        `data`: Bytes to replace the variables of.
+        `size`: Number of bytes.
+        `out`: Stream to write the result to.
+        `matcher`: Compiled variables, prefix and suffix.
+        `chunk_size`: Number of bytes to replace at a time.
+    */
+    void replaceVariablesInStream(const char* data, std::size_t size, std::ostream& out, const varmatch::Matcher& matcher, std::size_t chunk_size)
+    {
+        std::string result;
+        varmatch::Stream stream(matcher);
+
+        for(std::size_t i = 0; i < size; i += chunk_size) {
+            stream.write(data + i, std::min(chunk_size, size - i), result);
+            out.write(result.data(), result.size());
+            result.clear();
+        }
 
-                // move to the last character of the suffix (-1 to not skip a character in the next iteration)
-                if(has_suffix) {
-                    i = j + suffix.size() - 1;
-                } else {
-                    new_str.append(prefix);
-                    i += prefix.size() - 1;
+        stream.finish(result);
+        out.write(result.data(), result.size());
+    }
+
+    /*
+        Replaces all variables in the given path.
+        The file is scanned in place through a memory mapping and is only rewritten if its content changes.
+        Binary files are never scanned.
+        Files larger than `global::stream_threshold` are rewritten in chunks.
+        Returns `true` if the file was rewritten.
+
+        Parameters:
+        `file_path`: Path to the file.
+        `matcher`: Compiled variables, prefix and suffix.
+    */
+    bool replaceVariablesInFile(const std::string& file_path, const varmatch::Matcher& matcher)
+    {
+        os::MappedFile file(file_path);
+        if(isBinaryData(file.data(), file.size())) {
+            return false;
+        }
+
+        std::size_t first = matcher.firstVariable(file.data(), file.size());
+
+        // Leave files without variables untouched so their modification time is kept
+        if(first == varmatch::Matcher::npos) {
+            return false;
+        }
+
+        if(file.size() > global::stream_threshold) {
+            // Write to a temporary file next to the original so memory stays bounded
+            std::string temp_path = file_path + ".ctemplate-tmp";
+            try {
+                std::ofstream out(temp_path, std::ios::binary);
+                out.write(file.data(), first);
+                replaceVariablesInStream(file.data() + first, file.size() - first, out, matcher, global::stream_chunk_size);
+                out.close();
+                if(!out) {
+                    throw std::runtime_error("[Error] \"" + temp_path + "\" could not be written");
                 }
-                continue;
+                file.close();
+
+                fs::permissions(temp_path, fs::status(file_path).permissions());
+                fs::rename(temp_path, file_path);
+            } catch(...) {
+                // Never leave a partial copy next to the original
+                std::error_code ec;
+                fs::remove(temp_path, ec);
+                throw;
             }
+            return true;
+        }
+
+        std::string str;
+        str.reserve(file.size());
+        str.append(file.data(), first);
+        matcher.replace(file.data() + first, file.size() - first, str);
+
+        // Variables can have their own name as value
+        if(str.size() == file.size() && std::equal(str.begin(), str.end(), file.data())) {
+            return false;
+        }
+        file.close();
+
+        std::ofstream out(file_path, std::ios::binary);
+        out.write(str.data(), str.size());
+        return true;
+    }
+
+    /*
+        Copies a file and replaces all of its variables on the way.
+        The source is scanned through a memory mapping. Binary files and files without variables are copied as is,
+        and only files that change are rewritten.
+        Returns `true` if variables were replaced.
+
+        Parameters:
+        `source_path`: Path to the file to read.
+        `destination_path`: Path to the file to write.
+        `matcher`: Compiled variables, prefix and suffix.
+    */
+    bool replaceVariablesInFile(const std::string& source_path, const std::string& destination_path, const varmatch::Matcher& matcher)
+    {
+        std::error_code ec;
+        if(fs::equivalent(source_path, destination_path, ec)) {
+            return replaceVariablesInFile(destination_path, matcher);
+        }
 
-            new_str.push_back(str[i]);
+        os::MappedFile file(source_path);
+        std::size_t first = varmatch::Matcher::npos;
+        if(!isBinaryData(file.data(), file.size())) {
+            first = matcher.firstVariable(file.data(), file.size());
         }
 
-        return new_str;
+        if(first == varmatch::Matcher::npos) {
+            file.close();
+            path::copy(source_path, destination_path, path::CopyOption::OverwriteExisting);
+            return false;
+        }
+
+        std::ofstream out(destination_path, std::ios::binary);
+        out.write(file.data(), first);
+
+        if(file.size() > global::stream_threshold) {
+            replaceVariablesInStream(file.data() + first, file.size() - first, out, matcher, global::stream_chunk_size);
+        } else {
+            std::string str;
+            str.reserve(file.size() - first);
+            matcher.replace(file.data() + first, file.size() - first, str);
+            out.write(str.data(), str.size());
+        }
+
+        out.close();
+        if(!out) {
+            throw std::runtime_error("[Error] \"" + destination_path + "\" could not be written");
+        }
+        return true;
     }
 
     /*
         Replaces all variables in the given path.
+        Returns `true` if the file was rewritten.
 
         Parameters:
         `file_path`: Path to the file.
@@ -431,16 +628,85 @@ namespace helper {
         `prefix`: Variable prefix.
         `suffix`: Variable suffix.
     */
-    void replaceVariablesInFile(const std::string& file_path, 
+    bool replaceVariablesInFile(const std::string& file_path, 
                                 const std::unordered_map<std::string, std::string>& keyval, 
                                 const std::string& prefix, const std::string& suffix)
     {
-        std::string str = replaceVariables(readTextFromFile(file_path), keyval, prefix, suffix);
-        writeTextToFile(str, file_path);
+        return replaceVariablesInFile(file_path, varmatch::Matcher(keyval, prefix, suffix));
+    }
+
+    /*
+        Calls a function on every file in the given paths, spreading the files across a pool of threads.
+        The largest files are taken first so the threads finish at about the same time.
+        Returns the number of files the function returned `true` for.
+
+        Parameters:
+        `root_path`: Root path of the project directory.
+        `paths`: Paths relative to the root path. Directories are skipped.
+        `thread_count`: Number of threads to use. (0 to use every hardware thread)
+        `function`: Called with the relative and the full path of each file.
+    */
+    int forEachFile(const std::string& root_path, const pathtable::PathTable& paths, unsigned int thread_count,
+                    const std::function<bool(const std::string&, const std::string&)>& function)
+    {
+        std::vector<std::string> keys;
+        std::vector<std::string> files;
+        std::vector<std::uintmax_t> sizes;
+        for(const auto& i : paths) {
+            std::string path = path::joinPath(root_path, i);
+            std::error_code ec;
+            fs::file_status status = fs::status(path, ec);
+
+            if(fs::is_directory(status)) {
+                continue;
+            }
+
+            std::uintmax_t size = fs::is_regular_file(status) ? fs::file_size(path, ec) : 0;
+            keys.push_back(i);
+            files.push_back(path);
+            sizes.push_back(ec ? 0 : size);
+        }
+
+        std::vector<std::size_t> order(files.size());
+        for(std::size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return sizes[a] > sizes[b];
+        });
+
+        std::atomic<int> count(0);
+        parallel::forEach(order, thread_count, [&](std::size_t i) {
+            if(function(keys[i], files[i])) {
+                count++;
+            }
+        });
+
+        return count;
+    }
+
+    /*
+        Replaces all variables in the given paths.
+        Returns the number of files that were rewritten.
+
+        Parameters:
+        `root_path`: Root path of the project directory.
+        `paths`: Paths to replace the variables.
+        `matcher`: Compiled variables, prefix and suffix.
+        `thread_count`: Number of threads to use. (0 to use every hardware thread)
+    */
+    int replaceVariablesInAllFiles(const std::string& root_path, const pathtable::PathTable& paths, const varmatch::Matcher& matcher,
+                                   unsigned int thread_count)
+    {
+        return forEachFile(root_path, paths, thread_count, [&](const std::string&, const std::string& path) {
+            return replaceVariablesInFile(path, matcher);
+        });
     }
 
     /*
         Replaces all variables in the given paths.
+        Returns the number of files that were rewritten.
 
         Parameters:
         `root_path`: Root path of the project directory.
@@ -449,19 +715,268 @@ namespace helper {
         `prefix`: Variable prefix.
         `suffix`: Variable suffix.
     */
-    void replaceVariablesInAllFiles(const std::string& root_path, const std::set<std::string>& paths,
+    int replaceVariablesInAllFiles(const std::string& root_path, const pathtable::PathTable& paths,
                                 const std::unordered_map<std::string, std::string>& keyval, 
                                 const std::string& prefix, const std::string& suffix)
     {
+        return replaceVariablesInAllFiles(root_path, paths, varmatch::Matcher(keyval, prefix, suffix));
+    }
+
+    /*
+        Makes the directories needed to copy the given paths of a template to a project directory.
+        Each directory is made once, parents first, so the files can then be written without checking for parents.
+
+        Parameters:
+        `source_root_path`: Root path of the template.
+        `paths`: Paths to copy, relative to the root of the template.
+        `destination_root_path`: Root path of the project directory.
+    */
+    void makeDirectoryTree(const std::string& source_root_path, const pathtable::PathTable& paths, const std::string& destination_root_path)
+    {
+        std::vector<fs::path> directories;
         for(const auto& i : paths) {
-            std::string path = path::joinPath(root_path, i);
-            
-            if(path::isDirectory(path)) {
+            std::error_code ec;
+            fs::path path = fs::path(i).lexically_normal();
+            directories.push_back(fs::is_directory(fs::path(source_root_path) / i, ec) ? path : path.parent_path());
+        }
+
+        fs::path destination_root = destination_root_path;
+        fs::create_directories(destination_root);
+        for(const auto& i : path::directoryPlan(directories)) {
+            fs::create_directory(destination_root / i);
+        }
+    }
+
+    /*
+        Puts a template file into a project directory as a copy, a hard link or a symbolic link.
+        Falls back to a copy if the link cannot be made, such as a hard link across filesystems.
+        The parent directory of the destination must exist. Returns how the file was put.
+
+        Parameters:
+        `source_path`: Path to the file in the template.
+        `destination_path`: Path to put the file at.
+        `link_mode`: How to put the file.
+    */
+    LinkMode materializeFile(const std::string& source_path, const std::string& destination_path, LinkMode link_mode)
+    {
+        if(link_mode != LinkMode::Copy) {
+            std::error_code ec;
+            fs::remove(destination_path, ec);
+
+            if(link_mode == LinkMode::Hard) {
+                fs::create_hard_link(source_path, destination_path, ec);
+            } else {
+                fs::create_symlink(fs::absolute(source_path, ec), destination_path, ec);
+            }
+
+            if(!ec) {
+                return link_mode;
+            }
+        }
+
+        path::copyFile(source_path, destination_path, nullptr, false);
+        return LinkMode::Copy;
+    }
+
+    /*
+        Copies the files of a template that are neither substituted nor linked as one batch when the io_uring
+        backend of `path::setIoBackend()` is in use, so their syscalls are kept in flight together.
+        Returns the paths that are left to put into the project directory one by one.
+
+        Parameters:
+        `source_root_path`: Root path of the template.
+        `paths`: Paths to copy, relative to the root of the template.
+        `destination_root_path`: Root path of the project directory.
+        `included_files`: Paths whose variables are replaced.
+        `link_modes`: Files to link instead of copy.
+    */
+    pathtable::PathTable copyBatchedFiles(const std::string& source_root_path, const pathtable::PathTable& paths, const std::string& destination_root_path,
+                                          const pathtable::PathTable& included_files, const std::unordered_map<std::string, LinkMode>& link_modes)
+    {
+        if(path::getIoBackend() != path::IoBackend::IoUring) {
+            return paths;
+        }
+
+        // Both tables are sorted, so the included files are found in a single pass over them
+        std::set<std::string> batch;
+        pathtable::PathTable remaining;
+        auto included = included_files.begin();
+        for(const auto& i : paths) {
+            while(included != included_files.end() && *included < i) {
+                ++included;
+            }
+
+            auto it = link_modes.find(i);
+            if((included != included_files.end() && *included == i) || (it != link_modes.end() && it->second != LinkMode::Copy)) {
+                remaining.push_back(i);
+            } else {
+                batch.insert(batch.end(), i);
+            }
+        }
+
+        path::copy(source_root_path, batch, destination_root_path, path::CopyOption::OverwriteExisting);
+        return remaining;
+    }
+
+    /*
+        Copies the given paths of a template to a project directory.
+        Files are spread across a pool of threads.
+
+        Parameters:
+        `source_root_path`: Root path of the template.
+        `paths`: Paths to copy, relative to the root of the template.
+        `destination_root_path`: Root path of the project directory.
+        `link_modes`: Files to link instead of copy.
+        `thread_count`: Number of threads to use. (0 to use every hardware thread)
+    */
+    void copyTemplateFiles(const std::string& source_root_path, const pathtable::PathTable& paths, const std::string& destination_root_path,
+                           const std::unordered_map<std::string, LinkMode>& link_modes, unsigned int thread_count)
+    {
+        makeDirectoryTree(source_root_path, paths, destination_root_path);
+
+        pathtable::PathTable remaining = copyBatchedFiles(source_root_path, paths, destination_root_path, {}, link_modes);
+        forEachFile(source_root_path, remaining, thread_count, [&](const std::string& key, const std::string& source_path) {
+            auto it = link_modes.find(key);
+            materializeFile(source_path, path::joinPath(destination_root_path, key), it != link_modes.end() ? it->second : LinkMode::Copy);
+            return false;
+        });
+    }
+
+    /*
+        Copies the given paths of a template to a project directory, replacing variables on the way.
+        Each file is read once from the template and written once to the project directory.
+        Files in `included_files` have their variables replaced using the cached positions of the plan,
+        every other file is copied or linked as is. Substituted files are always written as real files.
+        Files are spread across a pool of threads. Returns the number of files whose variables were replaced.
+
+        Parameters:
+        `source_root_path`: Root path of the template.
+        `paths`: Paths to copy, relative to the root of the template.
+        `destination_root_path`: Root path of the project directory.
+        `included_files`: Paths to replace the variables of.
+        `plan`: Cached variable positions of the template.
+        `link_modes`: Files to link instead of copy if they are not substituted.
+        `thread_count`: Number of threads to use. (0 to use every hardware thread)
+    */
+    int copyTemplateFiles(const std::string& source_root_path, const pathtable::PathTable& paths, const std::string& destination_root_path,
+                          const pathtable::PathTable& included_files, SubstitutionPlan& plan,
+                          const std::unordered_map<std::string, LinkMode>& link_modes, unsigned int thread_count)
+    {
+        makeDirectoryTree(source_root_path, paths, destination_root_path);
+
+        pathtable::PathTable remaining = copyBatchedFiles(source_root_path, paths, destination_root_path, included_files, link_modes);
+        return forEachFile(source_root_path, remaining, thread_count, [&](const std::string& key, const std::string& source_path) {
+            std::string destination_path = path::joinPath(destination_root_path, key);
+            auto it = link_modes.find(key);
+            LinkMode link_mode = it != link_modes.end() ? it->second : LinkMode::Copy;
+
+            if(included_files.count(key) > 0) {
+                return plan.replaceVariablesInFile(key, source_path, destination_path, link_mode);
+            }
+
+            materializeFile(source_path, destination_path, link_mode);
+            return false;
+        });
+    }
+
+    /*
+        Returns how each of the given paths should be put into a project directory.
+        Paths matching the patterns in `link_paths` use that mode, every other path uses the default mode.
+        Paths that are copied are left out.
+
+        Parameters:
+        `paths`: Paths of the template.
+        `link_paths`: `json` object of patterns for each mode. (E.g. `{"hard": ["vendor"], "sym": ["assets"]}`)
+        `default_mode`: Mode of paths that do not match any pattern.
+    */
+    std::unordered_map<std::string, LinkMode> getLinkModes(const pathtable::PathTable& paths, const nlohmann::json& link_paths, LinkMode default_mode)
+    {
+        std::unordered_map<std::string, LinkMode> link_modes;
+        if(default_mode != LinkMode::Copy) {
+            for(const auto& i : paths) {
+                link_modes[i] = default_mode;
+            }
+        }
+
+        const std::vector<std::pair<std::string, LinkMode>> modes = {{"copy", LinkMode::Copy}, {"hard", LinkMode::Hard}, {"sym", LinkMode::Symbolic}};
+        for(const auto& mode : modes) {
+            if(!link_paths.is_object() || !link_paths.contains(mode.first)) {
                 continue;
             }
 
-            replaceVariablesInFile(path, keyval, prefix, suffix);
+            for(const auto& i : matchPaths(paths, PathFilter(jsonListToSet(link_paths.at(mode.first)), {}))) {
+                link_modes[i] = mode.second;
+            }
         }
+
+        for(auto it = link_modes.begin(); it != link_modes.end();) {
+            it = it->second == LinkMode::Copy ? link_modes.erase(it) : std::next(it);
+        }
+
+        return link_modes;
+    }
+
+    /*
+        Returns the path a template path ends up at once its filenames are replaced.
+
+        Parameters:
+        `path`: Path relative to the root of the template.
+        `included_filenames`: Paths whose filenames are replaced.
+        `matcher`: Compiled variables, prefix and suffix.
+    */
+    std::string renamedPath(const std::string& path, const pathtable::PathTable& included_filenames, const varmatch::Matcher& matcher)
+    {
+        fs::path original;
+        fs::path renamed;
+        for(const auto& i : fs::path(path)) {
+            original /= i;
+            renamed /= included_filenames.count(original.string()) > 0 ? replaceVariables(i.string(), matcher) : i.string();
+        }
+
+        return renamed.string();
+    }
+
+    /*
+        Records which files of a project directory are links into the template, so later operations know
+        they are shared with the template. Nothing is written if no file was linked.
+
+        Parameters:
+        `manifest_file`: Path to the manifest.
+        `source_root_path`: Root path of the template.
+        `destination_root_path`: Root path of the project directory.
+        `link_modes`: Files that were meant to be linked, relative to the root of the template.
+        `included_filenames`: Paths whose filenames were replaced.
+        `matcher`: Compiled variables, prefix and suffix.
+    */
+    void writeLinkManifest(const std::string& manifest_file, const std::string& source_root_path, const std::string& destination_root_path,
+                           const std::unordered_map<std::string, LinkMode>& link_modes, const pathtable::PathTable& included_filenames,
+                           const varmatch::Matcher& matcher)
+    {
+        json links = json::object();
+        for(const auto& i : link_modes) {
+            std::string renamed = renamedPath(i.first, included_filenames, matcher);
+            // Not `path::joinPath()`, which would resolve a symbolic link to its target
+            fs::path destination_path = fs::path(destination_root_path) / renamed;
+            std::error_code ec;
+
+            // Files that were substituted or could not be linked are real files
+            if(fs::is_symlink(destination_path, ec)) {
+                links[renamed] = "sym";
+            } else if(fs::equivalent(path::joinPath(source_root_path, i.first), destination_path, ec)) {
+                links[renamed] = "hard";
+            }
+        }
+
+        if(links.empty()) {
+            return;
+        }
+
+        json manifest = {
+            {"template", source_root_path},
+            {"links", links}
+        };
+
+        writeJsonToFile(manifest, manifest_file, 4);
     }
 
     /*
@@ -470,32 +985,78 @@ namespace helper {
         Parameters:
         `root_path`: Root path of the project directory.
         `paths`: Paths to replace the filenames.
-        `keyval`: Variables and their values.
-        `prefix`: Variable prefix.
-        `suffix`: Variable suffix.
+        `matcher`: Compiled variables, prefix and suffix.
     */
-    void replaceVariablesInAllFilenames(const std::string& root_path, const std::set<std::string>& paths,
-                                const std::unordered_map<std::string, std::string>& keyval,
-                                const std::string& prefix, const std::string& suffix)
+    void replaceVariablesInAllFilenames(const std::string& root_path, const pathtable::PathTable& paths, const varmatch::Matcher& matcher)
     {
         // Needs to change names from bottom to top of file tree to avoid error
-        // Ordered set is used to fix this
-        for(auto i = paths.rbegin(); i != paths.rend(); i++) {
-            std::string filename = path::filename(*i);
-            std::string path = path::joinPath(root_path, *i);
+        pathtable::PathTree tree(paths, path::directorySeparator());
+        tree.forEachBottomUp([&](std::size_t node) {
+            if(tree.id(node) == pathtable::PathTree::npos) {
+                return;
+            }
 
-            if(!path::exists(path)) {
-                continue;
+            std::string filename(tree.name(node));
+            // Not `path::joinPath()`, which would resolve a symbolic link and rename the file it points to
+            fs::path path = fs::path(root_path) / tree.path(node);
+            std::error_code ec;
+
+            if(!fs::exists(fs::symlink_status(path, ec))) {
+                return;
             }
 
-            std::string new_filename = replaceVariables(filename, keyval, prefix, suffix);
+            std::string new_filename = replaceVariables(filename, matcher);
 
             if(filename == new_filename) {
-                continue;
+                return;
             }
 
             path::rename(path, new_filename);
+        });
+    }
+
+    /*
+        Replaces all variables in the filenames of the given paths.
+
+        Parameters:
+        `root_path`: Root path of the project directory.
+        `paths`: Paths to replace the filenames.
+        `keyval`: Variables and their values.
+        `prefix`: Variable prefix.
+        `suffix`: Variable suffix.
+    */
+    void replaceVariablesInAllFilenames(const std::string& root_path, const pathtable::PathTable& paths,
+                                const std::unordered_map<std::string, std::string>& keyval,
+                                const std::string& prefix, const std::string& suffix)
+    {
+        replaceVariablesInAllFilenames(root_path, paths, varmatch::Matcher(keyval, prefix, suffix));
+    }
+
+    /*
+        Walk a directory and collect the paths added by `add`, sorted.
+
+        Parameters:
+        `path`: Path to walk.
+        `thread_count`: Number of threads that read directories. (0 to use every hardware thread)
+        `add`: Called with the paths of a thread and the relative path of each entry. Adds the entry to the paths if it is wanted.
+        `descend`: Called with the relative path of each directory. Returns whether to walk it.
+    */
+    template<typename Add, typename Descend>
+    std::vector<std::string> collectPaths(const std::string& path, unsigned int thread_count, Add add, Descend descend)
+    {
+        // Every thread keeps its own paths, which are sorted once at the end
+        std::vector<std::vector<std::string>> found(parallel::threadCount(thread_count));
+        path::walkDirectoryParallel(path, thread_count, [&](std::size_t worker, const std::string& p, bool) {
+            add(found[worker], p);
+        }, descend);
+
+        std::vector<std::string> paths = std::move(found[0]);
+        for(std::size_t i = 1; i < found.size(); i++) {
+            paths.insert(paths.end(), std::make_move_iterator(found[i].begin()), std::make_move_iterator(found[i].end()));
         }
+        std::sort(paths.begin(), paths.end());
+
+        return paths;
     }
 
     /*
@@ -504,16 +1065,54 @@ namespace helper {
         Parameters:
         `path`: Path to get all the paths.
         `relative_to`: Get the paths to relative to this path.
+        `thread_count`: Number of threads that read directories. (0 to use every hardware thread)
     */
-    std::set<std::string> getPaths(const std::string& path, const std::string& relative_to)
+    std::set<std::string> getPaths(const std::string& path, const std::string& relative_to, unsigned int thread_count)
     {
-        std::set<std::string> paths;
-        for(const auto& i : fs::recursive_directory_iterator(path)) {
-            std::string p = relative_to.empty() ? i.path().string() : path::relativePath(i, path);
-            paths.insert(path::normalizePath(p));
-        }
+        // Relative paths are built by the walk, so no path has to be made canonical
+        std::vector<std::string> paths = collectPaths(path, thread_count, [&](std::vector<std::string>& paths, const std::string& p) {
+            paths.push_back(relative_to.empty() ? path::normalizePath(fs::path(path) / p) : p);
+        }, [](const std::string&) {
+            return true;
+        });
 
-        return paths;
+        return std::set<std::string>(std::make_move_iterator(paths.begin()), std::make_move_iterator(paths.end()));
+    }
+
+    /*
+        Get all the paths in a given path relative to it, as a path table.
+
+        Parameters:
+        `path`: Path to get all the paths.
+        `thread_count`: Number of threads that read directories. (0 to use every hardware thread)
+    */
+    pathtable::PathTable getPathTable(const std::string& path, unsigned int thread_count)
+    {
+        return pathtable::PathTable(collectPaths(path, thread_count, [](std::vector<std::string>& paths, const std::string& p) {
+            paths.push_back(p);
+        }, [](const std::string&) {
+            return true;
+        }));
+    }
+
+    /*
+        Get the paths in a given path that match a filter, relative to that path. Directories whose contents
+        cannot match, such as a directory whose whole tree is excluded, are not walked.
+
+        Parameters:
+        `path`: Path to get the paths from.
+        `filter`: Include and exclude patterns.
+        `thread_count`: Number of threads that read directories. (0 to use every hardware thread)
+    */
+    pathtable::PathTable getMatchingPaths(const std::string& path, const PathFilter& filter, unsigned int thread_count)
+    {
+        return pathtable::PathTable(collectPaths(path, thread_count, [&](std::vector<std::string>& paths, const std::string& p) {
+            if(filter.matches(p)) {
+                paths.push_back(p);
+            }
+        }, [&](const std::string& p) {
+            return !filter.skipsContents(p);
+        }));
     }
 
     /*
@@ -554,46 +1153,7 @@ namespace helper {
                                      const std::set<std::string>& pattern_excludes, const std::unordered_set<std::string>& non_pattern_includes,
                                      const std::unordered_set<std::string>& non_pattern_excludes)
     {
-        std::set<std::string> matched;
-        for(const auto& str : included_paths) {
-            bool included = false;
-
-            // Check non-pattern includes first
-            if(non_pattern_includes.count(str) > 0) {
-                included = true;
-            } else {
-                // Check pattern includes
-                for(const auto& pattern : pattern_includes) {
-                    if(fmatch::match(str, pattern)) {
-                        included = true;
-                        break;
-                    }
-                }
-            }
-
-            if(included) {
-                bool excluded = false;
-
-                // Check non-pattern excludes first
-                if(non_pattern_excludes.count(str) > 0) {
-                    excluded = true;
-                } else {
-                    // Check pattern excludes
-                    for(const auto& pattern : pattern_excludes) {
-                        if(fmatch::match(str, pattern)) {
-                            excluded = true;
-                            break;
-                        }
-                    }
-                }
-
-                if(!excluded) {
-                    matched.insert(str);
-                }
-            }
-        }
-
-        return matched;
+        return matchPaths(included_paths, PathFilter({pattern_includes, non_pattern_includes}, {pattern_excludes, non_pattern_excludes}));
     }
 
     std::set<std::string> matchPaths(const std::set<std::string>& included_paths, const std::pair<std::set<std::string>, std::unordered_set<std::string>>& pattern_includes,
@@ -620,6 +1180,33 @@ namespace helper {
         return matchPaths(included_paths, pattern_includes, pattern_excludes);
     }
 
+    /*
+        Match a set of paths with a filter. The paths inside a directory whose contents the filter skips are not matched one by one.
+
+        Parameters:
+        `paths`: Set of paths to match to.
+        `filter`: Include and exclude patterns.
+    */
+    std::set<std::string> matchPaths(const std::set<std::string>& paths, const PathFilter& filter)
+    {
+        return matchPaths(pathtable::PathTable(paths), filter).toSet();
+    }
+
+    pathtable::PathTable matchPaths(const pathtable::PathTable& paths, const PathFilter& filter)
+    {
+        // Everything inside a directory whose contents the filter skips is passed over in one step
+        std::vector<std::string> matched;
+        pathtable::PathTree tree(paths, path::directorySeparator());
+        tree.forEach([&](std::size_t node, const std::string& p) {
+            if(tree.id(node) != pathtable::PathTree::npos && filter.matches(p)) {
+                matched.push_back(p);
+            }
+            return tree.childCount(node) == 0 || !filter.skipsContents(p);
+        });
+
+        return pathtable::PathTable(std::move(matched));
+    }
+
     /*
         Create a cache for search paths so initialization is faster next time around.
 
@@ -629,8 +1216,8 @@ namespace helper {
         `included_files`: Included file paths during initialization.
         `included_filenames`: Included filename paths during initialization.
     */
-    void makeCacheForSearchPaths(const std::string& cache_path, const nlohmann::json& search_paths, const std::set<std::string>& included_files,
-                                 const std::set<std::string>& included_filenames)
+    void makeCacheForSearchPaths(const std::string& cache_path, const nlohmann::json& search_paths, const pathtable::PathTable& included_files,
+                                 const pathtable::PathTable& included_filenames)
     {
         if(!path::exists(cache_path)) {
             path::createDirectory(cache_path);
@@ -658,4 +1245,341 @@ namespace helper {
 
         writeJsonToFile(includes, included_paths_cache, 4);
     }
+
+    /*
+        Parameters:
+        `matcher`: Compiled variables, prefix and suffix.
+        `max_file_size`: Files larger than this many bytes are never scanned. (0 for no limit)
+    */
+    SubstitutionPlan::SubstitutionPlan(const varmatch::Matcher& matcher, std::uintmax_t max_file_size)
+        : matcher_(matcher), max_file_size_(max_file_size) {}
+
+    std::size_t SubstitutionPlan::nameIndex(std::string_view name)
+    {
+        std::string key(name);
+        auto it = name_indices_.find(key);
+        if(it != name_indices_.end()) {
+            return it->second;
+        }
+
+        names_.push_back(key);
+        ids_.push_back(matcher_.find(name));
+        name_indices_.insert({key, names_.size() - 1});
+
+        return names_.size() - 1;
+    }
+
+    /*
+        Loads the plan from a file. A plan made with a different prefix, suffix or longest variable name
+        is discarded because it may have found different variables.
+
+        Parameters:
+        `plan_file`: Path to the plan file.
+    */
+    void SubstitutionPlan::load(const std::string& plan_file)
+    {
+        changed_ = true;
+        if(!path::exists(plan_file)) {
+            return;
+        }
+
+        json plan = json::parse(readTextFromFile(plan_file), nullptr, false);
+        if(!plan.is_object() || plan.value("variablePrefix", "") != matcher_.prefix() || plan.value("variableSuffix", "") != matcher_.suffix() ||
+           plan.value("maxNameSize", -1) != static_cast<long long>(matcher_.maxNameSize()) || 
+           !plan.contains("names") || !plan.at("names").is_array() || !plan.contains("files") || !plan.at("files").is_object()) {
+            return;
+        }
+
+        for(const auto& i : plan.at("names")) {
+            nameIndex(i.is_string() ? i.get<std::string>() : "");
+        }
+
+        if(names_.size() != plan.at("names").size()) {
+            names_.clear();
+            ids_.clear();
+            name_indices_.clear();
+            return;
+        }
+
+        for(auto it = plan.at("files").begin(); it != plan.at("files").end(); it++) {
+            const json& file = it.value();
+            if(!file.is_object() || !file.value("variables", json()).is_array()) {
+                continue;
+            }
+
+            Entry entry;
+            entry.size = file.value("size", std::uintmax_t(0));
+            entry.mtime = file.value("mtime", 0LL);
+            entry.binary = file.value("binary", false);
+
+            bool valid = true;
+            for(const auto& v : file.at("variables")) {
+                if(!v.is_array() || v.size() != 3 || !v[0].is_number_unsigned() || !v[1].is_number_unsigned() || 
+                   !v[2].is_number_unsigned() || v[2].get<std::size_t>() >= names_.size()) {
+                    valid = false;
+                    break;
+                }
+                entry.variables.push_back({v[0].get<std::size_t>(), v[1].get<std::size_t>(), v[2].get<std::size_t>()});
+            }
+
+            if(valid) {
+                files_.insert({it.key(), entry});
+            }
+        }
+
+        changed_ = false;
+    }
+
+    /*
+        Writes the plan to a file.
+
+        Parameters:
+        `plan_file`: Path to the plan file.
+    */
+    void SubstitutionPlan::save(const std::string& plan_file) const
+    {
+        json plan = {
+            {"variablePrefix", matcher_.prefix()},
+            {"variableSuffix", matcher_.suffix()},
+            {"maxNameSize", matcher_.maxNameSize()},
+            {"names", names_},
+            {"files", json::object()}
+        };
+
+        for(const auto& i : files_) {
+            plan.at("files")[i.first] = {
+                {"size", i.second.size},
+                {"mtime", i.second.mtime},
+                {"binary", i.second.binary},
+                {"variables", i.second.variables}
+            };
+        }
+
+        writeJsonToFile(plan, plan_file);
+    }
+
+    // Returns `true` if the plan has entries that are not saved yet.
+    bool SubstitutionPlan::changed() const
+    {
+        return changed_;
+    }
+
+    /*
+        Copies a file of a template and replaces all of its variables on the way.
+        The cached variable positions are used if the template file has the same size and modification time
+        as when they were found. Otherwise the file is scanned and the plan is updated.
+        Binary files, files larger than the maximum file size and files whose content would not change
+        are copied or linked as is. Returns `true` if variables were replaced. Safe to call from several threads for different files.
+
+        Parameters:
+        `key`: Path of the file relative to the root of the template.
+        `source_path`: Path to the file in the template.
+        `destination_path`: Path to copy the file to.
+        `link_mode`: How the file is put into the destination if it is not substituted.
+    */
+    bool SubstitutionPlan::replaceVariablesInFile(const std::string& key, const std::string& source_path, const std::string& destination_path,
+                                                  LinkMode link_mode)
+    {
+        std::error_code ec;
+        std::uintmax_t size = fs::file_size(source_path, ec);
+        long long mtime = fs::last_write_time(source_path, ec).time_since_epoch().count();
+
+        // Oversized files are copied as is
+        if(max_file_size_ > 0 && size > max_file_size_) {
+            materializeFile(source_path, destination_path, link_mode);
+            return false;
+        }
+
+        // Unchanged binary files and files without variables do not even need to be opened
+        const Entry* entry = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = files_.find(key);
+            if(it != files_.end() && it->second.size == size && it->second.mtime == mtime) {
+                entry = &it->second;
+            }
+        }
+
+        if(entry && (entry->binary || entry->variables.empty())) {
+            materializeFile(source_path, destination_path, link_mode);
+            return false;
+        }
+
+        os::MappedFile file(source_path);
+
+        if(!entry || file.size() != size) {
+            Entry fresh;
+            fresh.size = size;
+            fresh.mtime = mtime;
+            fresh.binary = isBinaryData(file.data(), file.size());
+
+            const std::size_t prefix_size = matcher_.prefix().size();
+            const std::size_t suffix_size = matcher_.suffix().size();
+            std::vector<std::string_view> names;
+            if(!fresh.binary) {
+                matcher_.scan(file.data(), file.size(), [&](std::size_t begin, std::size_t end, std::size_t) {
+                    names.push_back(std::string_view(file.data() + begin + prefix_size, end - begin - prefix_size - suffix_size));
+                    fresh.variables.push_back({begin, end - begin, 0});
+                    return true;
+                });
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(std::size_t i = 0; i < names.size(); i++) {
+                fresh.variables[i][2] = nameIndex(names[i]);
+            }
+
+            // Entries are never moved by later insertions, so they can be read outside of the lock
+            entry = &files_.insert_or_assign(key, std::move(fresh)).first->second;
+            changed_ = true;
+        }
+
+        // Matcher index of each variable
+        std::vector<std::size_t> ids(entry->variables.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for(std::size_t i = 0; i < ids.size(); i++) {
+                ids[i] = ids_[entry->variables[i][2]];
+            }
+        }
+
+        // Copy the file as is if every variable expands to its own text
+        bool unchanged = true;
+        for(std::size_t i = 0; i < ids.size(); i++) {
+            const auto& v = entry->variables[i];
+            if(ids[i] == varmatch::Matcher::npos || matcher_.value(ids[i]) != std::string_view(file.data() + v[0], v[1])) {
+                unchanged = false;
+                break;
+            }
+        }
+
+        if(unchanged) {
+            file.close();
+            materializeFile(source_path, destination_path, link_mode);
+            return false;
+        }
+
+        // Splice the values between the unchanged bytes straight into the destination
+        std::ofstream out(destination_path, std::ios::binary);
+        std::size_t written = 0;
+        for(std::size_t i = 0; i < ids.size(); i++) {
+            const auto& v = entry->variables[i];
+            out.write(file.data() + written, v[0] - written);
+
+            if(ids[i] != varmatch::Matcher::npos) {
+                out.write(matcher_.value(ids[i]).data(), matcher_.value(ids[i]).size());
+            }
+            written = v[0] + v[1];
+        }
+        out.write(file.data() + written, file.size() - written);
+
+        out.close();
+        if(!out) {
+            throw std::runtime_error("[Error] \"" + destination_path + "\" could not be written");
+        }
+        return true;
+    }
+
+    PathFilter::PathFilter(const std::pair<std::set<std::string>, std::unordered_set<std::string>>& includes,
+                           const std::pair<std::set<std::string>, std::unordered_set<std::string>>& excludes)
+        : pattern_includes_(includes.first), pattern_excludes_(excludes.first),
+          non_pattern_includes_(includes.second), non_pattern_excludes_(excludes.second)
+    {
+        for(const auto& i : non_pattern_includes_) {
+            for(std::size_t j = i.find_last_of("/\\"); j != std::string::npos && j > 0; j = i.find_last_of("/\\", j - 1)) {
+                include_parents_.insert(i.substr(0, j));
+            }
+        }
+
+        for(const auto& i : pattern_includes_) {
+            include_segments_.push_back(fmatch::separatePaths(i));
+        }
+
+        // Excludes that end with their only `**` cover everything inside the directories their other segments match
+        for(const auto& i : pattern_excludes_) {
+            std::vector<std::string> segments = fmatch::separatePaths(i);
+            if(!segments.empty() && segments.back() == "**" && std::count(segments.begin(), segments.end(), "**") == 1) {
+                segments.pop_back();
+                excluded_trees_.push_back(std::move(segments));
+            }
+        }
+    }
+
+    PathFilter::PathFilter(const std::set<std::string>& include, const std::set<std::string>& exclude)
+        : PathFilter(splitPatterns(include, "*?"), splitPatterns(exclude, "*?"))
+    {
+    }
+
+    /*
+        Check if a path is included and not excluded.
+
+        Parameters:
+        `path`: Path relative to the root of the template.
+    */
+    bool PathFilter::matches(const std::string& path) const
+    {
+        // Check non-pattern includes first
+        bool included = non_pattern_includes_.count(path) > 0;
+        for(auto pattern = pattern_includes_.begin(); !included && pattern != pattern_includes_.end(); pattern++) {
+            included = fmatch::match(path, *pattern);
+        }
+
+        if(!included) {
+            return false;
+        }
+
+        // Check non-pattern excludes first
+        if(non_pattern_excludes_.count(path) > 0) {
+            return false;
+        }
+
+        for(const auto& pattern : pattern_excludes_) {
+            if(fmatch::match(path, pattern)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /*
+        Check if no path inside a directory can match, either because every one of them is excluded or because no include
+        can match them. Only says so when it is certain, so skipping the contents never changes what matches.
+
+        Parameters:
+        `directory`: Path of the directory relative to the root of the template.
+    */
+    bool PathFilter::skipsContents(const std::string& directory) const
+    {
+        std::vector<std::string> segments = fmatch::separatePaths(directory);
+        auto leadingSegmentsMatch = [&](const std::vector<std::string>& pattern, std::size_t count) {
+            for(std::size_t i = 0; i < count; i++) {
+                if(!fmatch::match(segments[i], pattern[i])) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        for(const auto& i : excluded_trees_) {
+            if(i.size() <= segments.size() && leadingSegmentsMatch(i, i.size())) {
+                return true;
+            }
+        }
+
+        if(include_parents_.count(directory) > 0) {
+            return false;
+        }
+
+        // Segments before a `**` are matched one to one, so they must match the directory.
+        // After that the pattern still needs a segment left for the path inside.
+        for(const auto& i : include_segments_) {
+            std::size_t any = std::find(i.begin(), i.end(), "**") - i.begin();
+            if(leadingSegmentsMatch(i, std::min(any, segments.size())) && (any < segments.size() || i.size() > segments.size())) {
+                return false;
+            }
+        }
+
+        return true;
+    }
 }
\ No newline at end of file
@@ -72,6 +72,13 @@ int main(int argc, char** argv)
     // if config file exists, read from it. Else, use default settings then create the config file.
     if(path::exists(config_file_path)) {
         app_config = helper::readJsonFromFile(config_file_path);
+
+        // Add settings introduced after the config file was made
+        for(const auto& i : global::app_config.items()) {
+            if(!app_config.contains(i.key())) {
+                app_config[i.key()] = i.value();
+            }
+        }
     } else {
         helper::writeJsonToFile(app_config, config_file_path, 4);
     }
@@ -91,6 +98,33 @@ int main(int argc, char** argv)
 
     std::string container_name = app_config.at("containerName");
 
+    // Whether files are cloned instead of copied on filesystems that support it
+    std::string reflink = app_config.at("reflink");
+    if(reflink == "always") {
+        path::setReflinkOption(path::ReflinkOption::Always);
+    } else if(reflink == "never") {
+        path::setReflinkOption(path::ReflinkOption::Never);
+    } else if(reflink != "auto") {
+        std::cout << "[WARNING] Invalid value \"" << reflink << "\" for \"reflink\". Using \"auto\"." << std::endl;
+        std::cout << "          Use \"auto\", \"always\" or \"never\"." << std::endl;
+    }
+
+    // Whether batches of files are copied with io_uring instead of a pool of threads
+    std::string io_backend = app_config.at("ioBackend");
+    unsigned long io_queue_depth = 64;
+    try {
+        io_queue_depth = std::stoul(app_config.at("ioQueueDepth").get<std::string>());
+    } catch(...) {
+        std::cout << "[WARNING] Invalid value for \"ioQueueDepth\". Using 64." << std::endl;
+    }
+
+    if(io_backend == "io_uring") {
+        path::setIoBackend(path::IoBackend::IoUring, io_queue_depth);
+    } else if(io_backend != "threads") {
+        std::cout << "[WARNING] Invalid value \"" << io_backend << "\" for \"ioBackend\". Using \"threads\"." << std::endl;
+        std::cout << "          Use \"threads\" or \"io_uring\"." << std::endl;
+    }
+
     // For main command
     bool list_template = false;
     std::string tag;
@@ -112,6 +146,9 @@ int main(int argc, char** argv)
     init->add_option("-v, --variables", init_keyval, "Set variable values.\n(E.g: projectName=\"Hello World\")\nUse the 'info' subcommand to see the variables of a template");
     init->add_option("-i,--include", init_includes, "Paths to include in the\ntemplate when initializing\n(E.g: \"project/main.py\")");
     init->add_option("-e,--exclude", init_excludes, "Paths to exclude in the\ntemplate when initializing\n(E.g: \"project/main.py\")");
+    init->add_option("-j,--jobs", global::thread_count, "Number of threads used to list and copy\nfiles and replace variables\n(defaults to every hardware thread)")->expected(1);
+    std::string init_link;
+    init->add_option("--link", init_link, "Link files without variables into\nthe template instead of copying\n(hard or sym)")->check(CLI::IsMember({"hard", "sym"}));
     
     // For "add" subcommand
     CLI::App* add = app.add_subcommand("add", "Add a new template");
@@ -132,6 +169,9 @@ int main(int argc, char** argv)
     // For "list" subcommand
     CLI::App* list = app.add_subcommand("list", "List all templates");
 
+    // For "gc" subcommand
+    CLI::App* gc = app.add_subcommand("gc", "Finish deleting removed templates and files");
+
     // For "info" subcommand
     CLI::App* info = app.add_subcommand("info", "Show info about a template");
     std::string info_template;
@@ -151,6 +191,7 @@ int main(int argc, char** argv)
     reset->add_option("template", config_reset_values, "Template to reset config");
 
     CLI11_PARSE(app, argc, argv);
+    path::setCopyThreadCount(global::thread_count);
 
     // print(init_includes);
 
@@ -161,10 +202,12 @@ int main(int argc, char** argv)
     if(*init) { // "init" subcommand
         std::string init_to = path::joinPath(path::currentPath(), init_path);
         std::string template_path_to_init = path::joinPath(template_dir, init_template_name);
-        std::set<std::string> paths = helper::matchPaths(helper::getPaths(template_path_to_init, template_path_to_init),
-                                       helper::arrayToSet(init_includes), helper::arrayToSet(init_excludes));
+        helper::PathFilter filter(helper::arrayToSet(init_includes), helper::arrayToSet(init_excludes));
+        pathtable::PathTable paths = helper::getMatchingPaths(template_path_to_init, filter, global::thread_count);
+        helper::LinkMode link_mode = init_link == "hard" ? helper::LinkMode::Hard : 
+                                     init_link == "sym" ? helper::LinkMode::Symbolic : helper::LinkMode::Copy;
         initTemplate(template_dir, init_template_name, paths, container_name, 
-                     init_to, helper::mapKeyValues(init_keyval), init_force_overwrite);
+                     init_to, helper::mapKeyValues(init_keyval), init_force_overwrite, link_mode);
     } else if(*add) { // "add" subcommand
         std::string path_to_add = path::joinPath(path::currentPath(), add_path);
         addTemplate(template_dir, path_to_add, add_template_name, add_template_author, add_template_desc, container_name);
@@ -172,6 +215,8 @@ int main(int argc, char** argv)
         removeTemplates(template_dir, remove_template_names);
     } else if(*list) { // "list" subcommand
         listTemplates(template_dir, container_name);
+    } else if(*gc) { // "gc" subcommand
+        collectGarbage(template_dir);
     } else if(*info) { // "into" subcommand
         printTemplateInfo(template_dir, info_template, container_name);
     } else if(*config) { // "config" subcommand
@@ -2,6 +2,11 @@
 #include "ctemplate.hpp"
 #include "helper.hpp"
 #include "os.hpp"
+#include "global.hpp"
+#include "parallel.hpp"
+#include "fmatch.hpp"
+#include "pathtable.hpp"
+#include <random>
 
 namespace path = os::path;
 using json = nlohmann::json;
@@ -34,6 +39,68 @@ std::set<std::string> normalizePaths(const std::set<std::string>& s, const std::
     return n;
 }
 
+// Original byte by byte implementation of `helper::replaceVariables()` used as the reference output
+std::string referenceReplaceVariables(const std::string& str, const std::unordered_map<std::string, std::string>& keyval, 
+                                      const std::string& prefix, const std::string& suffix)
+{
+    if(prefix.empty() || suffix.empty()) {
+        return str;
+    }
+
+    std::size_t max_var_size = 0;
+    for(const auto& i : keyval) {
+        if(i.first.size() > max_var_size) {
+            max_var_size = i.first.size();
+        }
+    }
+
+    std::string new_str;
+    for(std::size_t i = 0; i < str.size(); i++) {
+        if(str[i] == prefix[0] && str.substr(i, prefix.size()) == prefix) {
+            std::string var;
+            std::size_t j = i + prefix.size();
+            std::size_t counter = 0;
+            bool has_suffix = false;
+
+            while(j < str.size() && counter <= max_var_size) {
+                if(str[j] == suffix[0] && str.substr(j, suffix.size()) == suffix) {
+                    has_suffix = true;
+                    break;
+                }
+                var.push_back(str[j]);
+                j++;
+                counter++;
+            }
+
+            if(has_suffix && keyval.count(var) > 0) {
+                new_str.append(keyval.at(var));
+            }
+
+            if(has_suffix) {
+                i = j + suffix.size() - 1;
+            } else {
+                new_str.append(prefix);
+                i += prefix.size() - 1;
+            }
+            continue;
+        }
+
+        new_str.push_back(str[i]);
+    }
+
+    return new_str;
+}
+
+std::string randomString(std::mt19937& rng, const std::string& alphabet, int size)
+{
+    std::string s;
+    for(int i = 0; i < size; i++) {
+        s.push_back(alphabet[rng() % alphabet.size()]);
+    }
+
+    return s;
+}
+
 // TEST(resetConfig, app_config)
 // {
 //     std::string config_file = path::joinPath(path::sourcePath(), "config.json");
@@ -229,6 +296,34 @@ TEST(initTemplate, cache_rewrite)
     path::remove(cache_path);
 }
 
+TEST(initTemplate, substitution_plan)
+{
+    std::string test_template_path = path::joinPath(test_path, "test_suites/init_template/test_templates/py");
+    std::string t_path = path::joinPath(test_path, "test_suites/init_template/test");
+    std::string tmp_path = path::joinPath(test_path, "test_suites/init_template/temp");
+    std::unordered_map<std::string, std::string> keyval = {{"project", "hello_world"}, {"name", "User"}};
+    std::string cache_path = path::joinPath(test_template_path, ".ctemplate/.cache");
+    std::string plan_path = path::joinPath(cache_path, "substitution_plan.json");
+    std::string expected_file_content = helper::readTextFromFile(path::joinPath(tmp_path, "test.py"));
+
+    initTemplate(test_template_path, container_name, t_path, keyval, true);
+
+    ASSERT_TRUE(path::exists(plan_path));
+    json plan = helper::readJsonFromFile(plan_path);
+    json entry = plan.at("files").at(path::normalizePath("!project!/!project!.py"));
+    ASSERT_EQ(entry.at("variables").size(), 1);
+    EXPECT_EQ(plan.at("names")[entry.at("variables")[0][2].get<int>()], "name");
+
+    // The second initialization splices the cached positions
+    initTemplate(test_template_path, container_name, t_path, keyval, true);
+
+    std::string actual_file_content = helper::readTextFromFile(path::joinPath(t_path, "hello_world/hello_world.py"));
+    EXPECT_EQ(actual_file_content, expected_file_content);
+
+    path::remove(t_path + path::directorySeparator());
+    path::remove(cache_path);
+}
+
 TEST(addTemplate, adding)
 {
     std::string add_path = path::joinPath(template_path, "t1");
@@ -411,6 +506,754 @@ TEST(replaceVariables, edge_cases)
     EXPECT_EQ(actual, expected);
 }
 
+TEST(replaceVariables, unknown_variables)
+{
+    std::string str = "Hello! World! and !name!!";
+    std::unordered_map<std::string, std::string> keyvals = {{"name", "John"}, {"project_name", "demo"}};
+
+    std::string actual = helper::replaceVariables(str, keyvals, "!", "!");
+    std::string expected = "Hello and John!";
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(replaceVariables, compiled_matcher)
+{
+    std::unordered_map<std::string, std::string> keyvals;
+    std::string str;
+    std::string expected;
+    for(int i = 0; i < 300; i++) {
+        keyvals.insert({"var" + std::to_string(i), "value" + std::to_string(i)});
+        str.append("<<var" + std::to_string(i) + ">> ");
+        expected.append("value" + std::to_string(i) + " ");
+    }
+
+    varmatch::Matcher matcher(keyvals, "<<", ">>");
+    EXPECT_EQ(helper::replaceVariables(str, matcher), expected);
+    EXPECT_EQ(helper::replaceVariables(str + str, matcher), expected + expected);
+}
+
+TEST(replaceVariables, sinks)
+{
+    varmatch::Matcher matcher({{"project", "hello_world"}, {"name", "User"}}, "!", "!");
+    std::string str = "Hello !name!, welcome to !project!.";
+    std::string expected = "Hello User, welcome to hello_world.";
+
+    std::string out;
+    varmatch::StringSink string_sink(out);
+    helper::replaceVariables(std::string_view(str), matcher, string_sink);
+    EXPECT_EQ(out, expected);
+
+    // Variables split across chunks
+    out.clear();
+    helper::replaceVariables(std::vector<std::string_view>{"Hello !na", "me!, welcome to !", "project!."}, matcher, string_sink);
+    EXPECT_EQ(out, expected);
+
+    char region[64];
+    varmatch::RegionSink region_sink(region, sizeof(region));
+    helper::replaceVariables(std::string_view(str), matcher, region_sink);
+    EXPECT_EQ(std::string(region, region_sink.size()), expected);
+    EXPECT_FALSE(region_sink.overflowed());
+
+    varmatch::RegionSink small_sink(region, 10);
+    helper::replaceVariables(std::string_view(str), matcher, small_sink);
+    EXPECT_EQ(std::string(region, small_sink.size()), expected.substr(0, 10));
+    EXPECT_TRUE(small_sink.overflowed());
+
+    std::string file = path::joinPath(temp_path, "sink.txt");
+    std::FILE* f = std::fopen(file.c_str(), "wb");
+    ASSERT_NE(f, nullptr);
+    {
+        varmatch::FileSink file_sink(fileno(f), 8);
+        helper::replaceVariables(std::string_view(str), matcher, file_sink);
+        EXPECT_TRUE(file_sink.good());
+    }
+    std::fclose(f);
+    EXPECT_EQ(helper::readTextFromFile(file), expected);
+
+    path::remove(file);
+}
+
+TEST(replaceVariables, same_as_reference)
+{
+    std::mt19937 rng(1234);
+    std::vector<std::pair<std::string, std::string>> delimiters = {{"!", "!"}, {"{!", "!}"}, {"{!", "!}]"}, {"!!", "!"},
+                                                                   {"ab", "ba"}, {"aa", "a"}, {"{{", "}}"}, {"!", ""}};
+    std::unordered_map<std::string, std::string> keyvals = {{"a", "X"}, {"ab", "YY"}, {"b!", "Z"}, {"", "E"}, {"aba", "\n"}};
+
+    for(const auto& d : delimiters) {
+        for(int i = 0; i < 2000; i++) {
+            std::string str = randomString(rng, "ab!{}] ", rng() % 40);
+            EXPECT_EQ(helper::replaceVariables(str, keyvals, d.first, d.second), referenceReplaceVariables(str, keyvals, d.first, d.second))
+                << "str: " << str << ", prefix: " << d.first << ", suffix: " << d.second;
+        }
+    }
+}
+
+TEST(replaceVariables, scan_modes_same_as_reference)
+{
+    std::mt19937 rng(4321);
+    std::vector<varmatch::ScanMode> modes = {varmatch::ScanMode::Scalar, varmatch::ScanMode::SSE2, varmatch::ScanMode::AVX2};
+    std::unordered_map<std::string, std::string> keyvals = {{"name", "John"}, {"age", "12"}, {"n!", "X"}};
+
+    for(const auto& mode : modes) {
+        if(!varmatch::isSupported(mode)) {
+            continue;
+        }
+
+        varmatch::Matcher matcher(keyvals, "{!", "!}", mode);
+        for(int i = 0; i < 2000; i++) {
+            // Mostly plain text so that the vectorized scanners skip whole blocks
+            std::string str = randomString(rng, "abcdefghijklmnopqrstuvwxyz \n", rng() % 300);
+            for(int j = rng() % 6; j > 0 && !str.empty(); j--) {
+                std::string token = randomString(rng, "{!}nameg", 1 + rng() % 8);
+                str.insert(rng() % str.size(), token);
+            }
+
+            EXPECT_EQ(matcher.replace(str), referenceReplaceVariables(str, keyvals, "{!", "!}")) << "str: " << str;
+        }
+    }
+}
+
+TEST(replaceVariablesInStream, same_as_reference)
+{
+    std::mt19937 rng(2468);
+    std::unordered_map<std::string, std::string> keyvals = {{"name", "John"}, {"age", "12"}, {"a!", "X"}};
+    varmatch::Matcher matcher(keyvals, "{!", "!}]");
+
+    for(int chunk_size = 1; chunk_size <= 9; chunk_size++) {
+        for(int i = 0; i < 300; i++) {
+            std::string str = randomString(rng, "{!}]nameg ", rng() % 80);
+            std::stringstream in(str);
+            std::stringstream out;
+
+            helper::replaceVariablesInStream(in, out, matcher, chunk_size);
+            EXPECT_EQ(out.str(), referenceReplaceVariables(str, keyvals, "{!", "!}]")) << "str: " << str << ", chunk size: " << chunk_size;
+        }
+    }
+}
+
+TEST(replaceVariablesInFile, large_file)
+{
+    path::createDirectory(temp_path);
+    std::string file = path::joinPath(temp_path, "large.txt");
+    std::string str;
+    for(int i = 0; i < 1000; i++) {
+        str.append("line " + std::to_string(i) + " of !project! by !name!\n");
+    }
+    path::createFile(file, str, path::CopyOption::OverwriteAll);
+
+    std::uintmax_t threshold = global::stream_threshold;
+    std::size_t chunk_size = global::stream_chunk_size;
+    global::stream_threshold = 0;
+    global::stream_chunk_size = 100;
+
+    std::unordered_map<std::string, std::string> keyvals = {{"project", "hello_world"}, {"name", "User"}};
+    helper::replaceVariablesInFile(file, keyvals, "!", "!");
+
+    global::stream_threshold = threshold;
+    global::stream_chunk_size = chunk_size;
+
+    EXPECT_EQ(helper::readTextFromFile(file), referenceReplaceVariables(str, keyvals, "!", "!"));
+    ASSERT_TRUE(!path::exists(file + ".ctemplate-tmp"));
+
+    path::remove(file);
+}
+
+TEST(replaceVariablesInFile, source_to_destination)
+{
+    path::createDirectory(temp_path);
+    std::string with_vars = path::joinPath(temp_path, "with_vars.txt");
+    std::string without_vars = path::joinPath(temp_path, "without_vars.txt");
+    std::string destination = path::joinPath(temp_path, "destination.txt");
+    std::unordered_map<std::string, std::string> keyvals = {{"project", "hello_world"}, {"name", "User"}};
+    varmatch::Matcher matcher(keyvals, "!", "!");
+
+    path::createFile(with_vars, "Hello !name!, welcome to !project!.", path::CopyOption::OverwriteAll);
+    path::createFile(without_vars, "Hello there! No variables here", path::CopyOption::OverwriteAll);
+
+    helper::replaceVariablesInFile(with_vars, destination, matcher);
+    EXPECT_EQ(helper::readTextFromFile(destination), "Hello User, welcome to hello_world.");
+    EXPECT_EQ(helper::readTextFromFile(with_vars), "Hello !name!, welcome to !project!.");
+
+    helper::replaceVariablesInFile(without_vars, destination, matcher);
+    EXPECT_EQ(helper::readTextFromFile(destination), "Hello there! No variables here");
+
+    path::remove(with_vars);
+    path::remove(without_vars);
+    path::remove(destination);
+}
+
+TEST(replaceVariablesInAllFiles, skip_unchanged_files)
+{
+    std::string root = path::joinPath(temp_path, "skip_unchanged");
+    path::createDirectory(root);
+    path::createFile(path::joinPath(root, "vars.txt"), "Hello !name!", path::CopyOption::OverwriteAll);
+    path::createFile(path::joinPath(root, "plain.txt"), "Hello there!", path::CopyOption::OverwriteAll);
+    path::createFile(path::joinPath(root, "same.txt"), "Hello !same!", path::CopyOption::OverwriteAll);
+
+    auto old_time = std::filesystem::file_time_type::clock::now() - std::chrono::hours(24);
+    std::filesystem::last_write_time(path::joinPath(root, "plain.txt"), old_time);
+    std::filesystem::last_write_time(path::joinPath(root, "same.txt"), old_time);
+
+    std::unordered_map<std::string, std::string> keyvals = {{"name", "User"}, {"same", "!same!"}};
+    int rewritten = helper::replaceVariablesInAllFiles(root, {"vars.txt", "plain.txt", "same.txt"}, keyvals, "!", "!");
+
+    EXPECT_EQ(rewritten, 1);
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(root, "vars.txt")), "Hello User");
+    EXPECT_EQ(std::filesystem::last_write_time(path::joinPath(root, "plain.txt")), old_time);
+    EXPECT_EQ(std::filesystem::last_write_time(path::joinPath(root, "same.txt")), old_time);
+
+    path::remove(root);
+}
+
+TEST(replaceVariablesInAllFiles, parallel)
+{
+    std::string root = path::joinPath(temp_path, "parallel");
+    path::createDirectory(root);
+
+    std::set<std::string> paths;
+    for(int i = 0; i < 64; i++) {
+        std::string name = "file" + std::to_string(i) + ".txt";
+        std::string content;
+        for(int j = 0; j <= i * 37; j++) {
+            content += "!name! " + std::to_string(j) + "\n";
+        }
+        path::createFile(path::joinPath(root, name), content, path::CopyOption::OverwriteAll);
+        paths.insert(name);
+    }
+
+    varmatch::Matcher matcher({{"name", "User"}}, "!", "!");
+    int rewritten = helper::replaceVariablesInAllFiles(root, paths, matcher, 8);
+
+    EXPECT_EQ(rewritten, 64);
+    for(int i = 0; i < 64; i++) {
+        std::string expected;
+        for(int j = 0; j <= i * 37; j++) {
+            expected += "User " + std::to_string(j) + "\n";
+        }
+        EXPECT_EQ(helper::readTextFromFile(path::joinPath(root, "file" + std::to_string(i) + ".txt")), expected);
+    }
+
+    path::remove(root);
+}
+
+TEST(forEach, first_error_is_rethrown)
+{
+    std::vector<std::size_t> tasks = {5, 3, 9, 0, 7, 1, 8, 2, 6, 4};
+    std::atomic<int> ran(0);
+
+    for(int attempt = 0; attempt < 10; attempt++) {
+        try {
+            parallel::forEach(tasks, 4, [&](std::size_t i) {
+                ran++;
+                if(i == 2 || i == 7) {
+                    throw std::runtime_error("task " + std::to_string(i));
+                }
+            });
+            FAIL();
+        } catch(const std::runtime_error& e) {
+            EXPECT_EQ(std::string(e.what()), "task 2");
+        }
+    }
+
+    EXPECT_EQ(ran, 100);
+}
+
+TEST(copyTemplateFiles, replaces_included_files)
+{
+    std::string source = path::joinPath(temp_path, "fused_source");
+    std::string destination = path::joinPath(temp_path, "fused_destination");
+    path::createDirectory(path::joinPath(source, "src"));
+    path::createDirectory(path::joinPath(source, "empty"));
+    path::createFile(path::joinPath(source, "src/main.txt"), "Hello !name!", path::CopyOption::OverwriteAll);
+    path::createFile(path::joinPath(source, "src/other.txt"), "Hello !name!", path::CopyOption::OverwriteAll);
+    path::createFile(path::joinPath(source, "plain.txt"), "Hello there", path::CopyOption::OverwriteAll);
+
+    varmatch::Matcher matcher({{"name", "User"}}, "!", "!");
+    helper::SubstitutionPlan plan(matcher);
+    std::set<std::string> paths = normalizePaths(std::set<std::string>{"src", "src/main.txt", "src/other.txt", "plain.txt", "empty"}, source);
+    std::set<std::string> included = normalizePaths(std::set<std::string>{"src/main.txt", "plain.txt"}, source);
+    int rewritten = helper::copyTemplateFiles(source, paths, destination, included, plan, {}, 4);
+
+    EXPECT_EQ(rewritten, 1);
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, "src/main.txt")), "Hello User");
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, "src/other.txt")), "Hello !name!");
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, "plain.txt")), "Hello there");
+    EXPECT_TRUE(path::isDirectory(path::joinPath(destination, "empty")));
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(source, "src/main.txt")), "Hello !name!");
+
+    path::remove(source);
+    path::remove(destination);
+}
+
+TEST(copyTemplateFiles, link_modes)
+{
+    std::string source = path::joinPath(temp_path, "link_source");
+    std::string destination = path::joinPath(temp_path, "link_destination");
+    path::createDirectory(path::joinPath(source, "assets"));
+    path::createDirectory(path::joinPath(source, "!name!"));
+    path::createFile(path::joinPath(source, "assets/hard.bin"), "hard", path::CopyOption::OverwriteAll);
+    path::createFile(path::joinPath(source, "assets/sym.bin"), "sym", path::CopyOption::OverwriteAll);
+    path::createFile(path::joinPath(source, "!name!/main.txt"), "Hello !name!", path::CopyOption::OverwriteAll);
+
+    std::set<std::string> paths = helper::getPaths(source, source);
+    json link_paths = {{"sym", json::array({"assets/sym.bin"})}};
+    std::unordered_map<std::string, helper::LinkMode> link_modes = helper::getLinkModes(paths, link_paths, helper::LinkMode::Hard);
+    EXPECT_EQ(link_modes.at(path::normalizePath("assets/hard.bin")), helper::LinkMode::Hard);
+    EXPECT_EQ(link_modes.at(path::normalizePath("assets/sym.bin")), helper::LinkMode::Symbolic);
+
+    varmatch::Matcher matcher({{"name", "User"}}, "!", "!");
+    helper::SubstitutionPlan plan(matcher);
+    std::set<std::string> included = {path::normalizePath("!name!/main.txt")};
+    std::set<std::string> included_filenames = {"!name!"};
+    helper::copyTemplateFiles(source, paths, destination, included, plan, link_modes, 2);
+    helper::replaceVariablesInAllFilenames(destination, included_filenames, matcher);
+
+    std::string manifest_file = path::joinPath(destination, ".ctemplate-manifest.json");
+    helper::writeLinkManifest(manifest_file, source, destination, link_modes, included_filenames, matcher);
+
+    // Substituted files are real files
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, "User/main.txt")), "Hello User");
+    EXPECT_FALSE(std::filesystem::equivalent(path::joinPath(source, "!name!/main.txt"), path::joinPath(destination, "User/main.txt")));
+    EXPECT_TRUE(std::filesystem::is_symlink(std::filesystem::path(destination) / "assets" / "sym.bin"));
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, "assets/sym.bin")), "sym");
+    EXPECT_TRUE(std::filesystem::equivalent(path::joinPath(source, "assets/hard.bin"), path::joinPath(destination, "assets/hard.bin")));
+
+    json manifest = helper::readJsonFromFile(manifest_file);
+    json expected_links = {{path::normalizePath("assets/hard.bin"), "hard"}, {path::normalizePath("assets/sym.bin"), "sym"}};
+    EXPECT_EQ(manifest.at("links"), expected_links);
+
+    path::remove(source);
+    path::remove(destination);
+}
+
+TEST(copyTemplateFiles, renames_symlinks_not_their_targets)
+{
+    std::string source = path::joinPath(temp_path, "link_rename_source");
+    std::string destination = path::joinPath(temp_path, "link_rename_destination");
+    path::createDirectory(path::joinPath(source, "test"));
+    path::createFile(path::joinPath(source, "test/test_!name!.py"), "test", path::CopyOption::OverwriteAll);
+
+    std::set<std::string> paths = helper::getPaths(source, source);
+    std::unordered_map<std::string, helper::LinkMode> link_modes = helper::getLinkModes(paths, json::object(), helper::LinkMode::Symbolic);
+
+    varmatch::Matcher matcher({{"name", "User"}}, "!", "!");
+    helper::SubstitutionPlan plan(matcher);
+    std::set<std::string> included_filenames = {path::normalizePath("test/test_!name!.py")};
+    helper::copyTemplateFiles(source, paths, destination, {}, plan, link_modes, 2);
+    helper::replaceVariablesInAllFilenames(destination, included_filenames, matcher);
+
+    // The link is renamed and still points to the untouched template file
+    std::filesystem::path renamed = std::filesystem::path(destination) / "test" / "test_User.py";
+    EXPECT_TRUE(std::filesystem::is_symlink(renamed));
+    EXPECT_EQ(helper::readTextFromFile(renamed.string()), "test");
+    EXPECT_TRUE(path::exists(path::joinPath(source, "test/test_!name!.py")));
+    EXPECT_FALSE(path::exists(path::joinPath(source, "test/test_User.py")));
+
+    path::remove(source);
+    path::remove(destination);
+}
+
+TEST(copy, path_set_in_parallel)
+{
+    std::string source = path::joinPath(temp_path, "parallel_copy_source");
+    std::string destination = path::joinPath(temp_path, "parallel_copy_destination");
+    std::set<std::string> paths;
+    for(int i = 0; i < 8; i++) {
+        std::string directory = "dir" + std::to_string(i);
+        path::createDirectory(path::joinPath(source, directory));
+        paths.insert(directory);
+        for(int j = 0; j < 16; j++) {
+            std::string file = path::joinPath(directory, "file" + std::to_string(j) + ".txt");
+            path::createFile(path::joinPath(source, file), file, path::CopyOption::OverwriteAll);
+            paths.insert(file);
+        }
+    }
+    path::createDirectory(destination);
+
+    path::setCopyThreadCount(4);
+    EXPECT_TRUE(path::copy(source, paths, destination, path::CopyOption::OverwriteExisting));
+    path::setCopyThreadCount(0);
+
+    for(const auto& i : paths) {
+        if(path::isDirectory(path::joinPath(source, i))) {
+            EXPECT_TRUE(path::isDirectory(path::joinPath(destination, i)));
+        } else {
+            EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, i)), i);
+        }
+    }
+
+    path::remove(source);
+    path::remove(destination);
+}
+
+TEST(copy, path_set_makes_missing_parents)
+{
+    std::string source = path::joinPath(temp_path, "nested_copy_source");
+    std::string destination = path::joinPath(temp_path, "nested_copy_destination");
+    std::set<std::string> paths = {"a/b/c/", "a/b/c/deep.txt", "x/y/z.txt"};
+    for(int i = 0; i < 150; i++) {
+        paths.insert("wide/file" + std::to_string(i) + ".txt");
+    }
+
+    for(const auto& i : paths) {
+        std::filesystem::create_directories(std::filesystem::path(source) / std::filesystem::path(i).parent_path());
+        if(i.back() != '/') {
+            path::createFile(path::joinPath(source, i), i, path::CopyOption::OverwriteAll);
+        }
+    }
+    std::filesystem::create_directories(std::filesystem::path(destination) / "x/y");
+    path::createFile(path::joinPath(destination, "x/y/z.txt"), "old", path::CopyOption::OverwriteAll);
+    path::createFile(path::joinPath(destination, "kept.txt"), "kept", path::CopyOption::OverwriteAll);
+
+    EXPECT_TRUE(path::copy(source, paths, destination, path::CopyOption::OverwriteExisting));
+
+    for(const auto& i : paths) {
+        if(i.back() == '/') {
+            EXPECT_TRUE(path::isDirectory(path::joinPath(destination, i)));
+        } else {
+            EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, i)), i);
+        }
+    }
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, "kept.txt")), "kept");
+
+    path::remove(source);
+    path::remove(destination);
+}
+
+TEST(copy, io_uring_backend)
+{
+    std::string source = path::joinPath(temp_path, "io_uring_source");
+    std::string destination = path::joinPath(temp_path, "io_uring_destination");
+    std::mt19937 rng(7);
+    std::map<std::string, std::string> files;
+    std::set<std::string> paths = {"dir/"};
+    path::createDirectory(path::joinPath(source, "dir"));
+    for(int i = 0; i < 40; i++) {
+        std::string file = (i % 2 == 0 ? "dir/file" : "file") + std::to_string(i) + ".bin";
+        std::size_t size = i % 5 == 0 ? 0 : (i % 7 == 0 ? 300 * 1024 + i : 100 * i);
+        files[file] = randomString(rng, std::string("xy\0\n", 4), size);
+        std::ofstream(path::joinPath(source, file), std::ios::binary) << files[file];
+        paths.insert(file);
+    }
+    path::createDirectory(destination);
+
+    path::setIoBackend(path::IoBackend::IoUring, 8);
+    EXPECT_TRUE(path::copy(source, paths, destination, path::CopyOption::OverwriteExisting));
+    path::setIoBackend(path::IoBackend::Threads);
+
+    for(const auto& i : files) {
+        EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, i.first)), i.second) << i.first;
+    }
+
+    path::remove(source);
+    path::remove(destination);
+}
+
+TEST(replaceDirectory, swaps_in_staged_tree)
+{
+    std::string destination = path::joinPath(temp_path, "swap_destination");
+    path::createDirectory(destination);
+    EXPECT_TRUE(path::makeStagingDirectory(destination).empty());
+
+    path::createFile(path::joinPath(destination, "old.txt"), "old", path::CopyOption::OverwriteAll);
+    std::filesystem::path staging = path::makeStagingDirectory(destination);
+    #if defined(__linux__)
+        ASSERT_FALSE(staging.empty());
+        EXPECT_EQ(staging.parent_path(), std::filesystem::canonical(destination).parent_path());
+        EXPECT_TRUE(path::isEmpty(staging));
+
+        path::createFile((staging / "new.txt").string(), "new", path::CopyOption::OverwriteAll);
+        path::replaceDirectory(staging, destination);
+
+        EXPECT_EQ(helper::readTextFromFile(path::joinPath(destination, "new.txt")), "new");
+        EXPECT_FALSE(path::exists(path::joinPath(destination, "old.txt")));
+
+        // The old tree is removed in the background
+        for(int i = 0; i < 100 && std::filesystem::exists(staging); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        EXPECT_FALSE(std::filesystem::exists(staging));
+    #else
+        EXPECT_TRUE(staging.empty());
+    #endif
+
+    path::remove(destination);
+}
+
+TEST(remove, removes_tree_without_following_links)
+{
+    std::string tree = path::joinPath(temp_path, "remove_tree");
+    std::string outside = path::joinPath(temp_path, "remove_outside");
+    path::createDirectory(outside);
+    path::createFile(path::joinPath(outside, "keep.txt"), "keep", path::CopyOption::OverwriteAll);
+    for(int i = 0; i < 6; i++) {
+        std::filesystem::path directory = std::filesystem::path(tree) / ("d" + std::to_string(i)) / "nested" / "deeper";
+        std::filesystem::create_directories(directory);
+        for(int j = 0; j < 10; j++) {
+            std::ofstream(directory / ("f" + std::to_string(j))) << j;
+            std::ofstream(directory.parent_path() / ("g" + std::to_string(j))) << j;
+        }
+    }
+    std::filesystem::create_directory_symlink(outside, std::filesystem::path(tree) / "link");
+
+    path::setCopyThreadCount(4);
+    EXPECT_TRUE(path::remove(tree));
+    path::setCopyThreadCount(0);
+
+    EXPECT_FALSE(std::filesystem::exists(tree));
+    EXPECT_EQ(helper::readTextFromFile(path::joinPath(outside, "keep.txt")), "keep");
+    path::remove(outside);
+}
+
+TEST(walkDirectory, relative_paths_without_following_links)
+{
+    std::string root = path::joinPath(temp_path, "walk_root");
+    std::filesystem::create_directories(std::filesystem::path(root) / "a" / "b");
+    std::filesystem::create_directories(std::filesystem::path(root) / "empty");
+    std::ofstream(std::filesystem::path(root) / "a" / "b" / "file.txt") << "file";
+    std::ofstream(std::filesystem::path(root) / "top.txt") << "top";
+    std::filesystem::create_directory_symlink(std::filesystem::path(root) / "a", std::filesystem::path(root) / "link");
+
+    std::map<std::string, bool> entries;
+    std::vector<std::string> order;
+    path::walkDirectory(root, [&](const std::string& p, bool is_directory) {
+        EXPECT_TRUE(entries.emplace(p, is_directory).second) << p;
+        order.push_back(p);
+    });
+
+    std::map<std::string, bool> expected = {
+        {"a", true}, {path::normalizePath("a/b"), true}, {path::normalizePath("a/b/file.txt"), false},
+        {"empty", true}, {"link", false}, {"top.txt", false}
+    };
+    EXPECT_EQ(entries, expected);
+
+    // Directories come before their contents
+    auto position = [&](const std::string& p) {
+        return std::find(order.begin(), order.end(), path::normalizePath(p)) - order.begin();
+    };
+    EXPECT_LT(position("a"), position("a/b"));
+    EXPECT_LT(position("a/b"), position("a/b/file.txt"));
+
+    EXPECT_EQ(helper::getPaths(root, root), std::set<std::string>({"a", path::normalizePath("a/b"), path::normalizePath("a/b/file.txt"),
+                                                                    "empty", "link", "top.txt"}));
+    EXPECT_THROW(path::walkDirectory(path::joinPath(root, "missing"), [](const std::string&, bool) {}), std::runtime_error);
+
+    path::remove(root);
+}
+
+TEST(getPaths, parallel_matches_serial)
+{
+    std::string root = path::joinPath(temp_path, "parallel_walk");
+    for(int i = 0; i < 8; i++) {
+        std::filesystem::path directory = std::filesystem::path(root) / ("d" + std::to_string(i));
+        for(int depth = 0; depth < i % 4 + 1; depth++) {
+            directory /= "n" + std::to_string(depth);
+            std::filesystem::create_directories(directory);
+            for(int j = 0; j < 20; j++) {
+                std::ofstream(directory / ("f" + std::to_string(j))) << j;
+            }
+        }
+    }
+
+    std::set<std::string> serial = helper::getPaths(root, root);
+    EXPECT_EQ(serial.size(), 8 + 20 * 20 + 20);
+    EXPECT_EQ(helper::getPaths(root, root, 4), serial);
+    EXPECT_EQ(helper::getPaths(root, "", 3), helper::getPaths(root));
+
+    // Every thread reports a directory before anything in it
+    std::mutex mutex;
+    std::vector<std::string> order;
+    path::walkDirectoryParallel(root, 4, [&](std::size_t worker, const std::string& p, bool) {
+        EXPECT_LT(worker, 4);
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(p);
+    });
+    ASSERT_EQ(std::set<std::string>(order.begin(), order.end()), serial);
+    for(std::size_t i = 0; i < order.size(); i++) {
+        std::string parent = std::filesystem::path(order[i]).parent_path().string();
+        if(!parent.empty()) {
+            EXPECT_LT(std::find(order.begin(), order.end(), parent) - order.begin(), i) << order[i];
+        }
+    }
+
+    EXPECT_THROW(helper::getPaths(path::joinPath(root, "missing"), "", 4), std::runtime_error);
+    path::remove(root);
+}
+
+TEST(moveToTrash, trash_is_emptied)
+{
+    std::string trash = path::joinPath(temp_path, "trash");
+    std::string first = path::joinPath(temp_path, "trashed");
+    std::string second = path::joinPath(temp_path, "trashed_file.txt");
+    std::filesystem::create_directories(std::filesystem::path(first) / "sub");
+    std::ofstream(std::filesystem::path(first) / "sub" / "file.txt") << "data";
+    std::ofstream(second) << "data";
+
+    std::filesystem::path trashed = path::moveToTrash(first, trash);
+    ASSERT_FALSE(trashed.empty());
+    EXPECT_EQ(trashed.parent_path(), std::filesystem::path(trash));
+    EXPECT_FALSE(path::exists(first));
+    EXPECT_TRUE(std::filesystem::exists(trashed / "sub" / "file.txt"));
+
+    // Paths with the same name do not replace each other in the trash
+    std::filesystem::create_directory(first);
+    EXPECT_NE(path::moveToTrash(first, trash), trashed);
+    EXPECT_FALSE(path::moveToTrash(second, trash).empty());
+
+    EXPECT_EQ(path::emptyTrash(trash), 3);
+    EXPECT_TRUE(path::isEmpty(trash));
+    EXPECT_EQ(path::emptyTrash(trash), 0);
+
+    path::remove(trash);
+}
+
+TEST(directoryPlan, parents_first_once)
+{
+    std::set<std::filesystem::path> plan = path::directoryPlan({"a/b/c", "a/b", "a/b/c/", "x/y", "", "a/d"});
+    std::vector<std::filesystem::path> expected = {"a", "a/b", "a/b/c", "a/d", "x", "x/y"};
+    EXPECT_EQ(std::vector<std::filesystem::path>(plan.begin(), plan.end()), expected);
+}
+
+TEST(copyFile, copies_content)
+{
+    std::string source = path::joinPath(temp_path, "copy_source.bin");
+    std::string destination = path::joinPath(temp_path, "copy_dir/copy_destination.bin");
+    std::mt19937 rng(42);
+    std::string content = randomString(rng, std::string("ab\0\n", 4), 3 * 1024 * 1024 + 17);
+    std::ofstream(source, std::ios::binary) << content;
+
+    path::CopyMethod method;
+    ASSERT_TRUE(path::copyFile(source, destination, &method));
+    EXPECT_EQ(helper::readTextFromFile(destination), content);
+    #if defined(__linux__)
+        EXPECT_NE(method, path::CopyMethod::Stream);
+
+        // Files in /proc report a size of 0 but still have content
+        ASSERT_TRUE(path::copyFile("/proc/self/status", destination));
+        EXPECT_FALSE(helper::readTextFromFile(destination).empty());
+    #endif
+
+    path::remove(source);
+    path::remove(path::joinPath(temp_path, "copy_dir"));
+}
+
+TEST(copyFile, reflink_options)
+{
+    std::string source = path::joinPath(temp_path, "reflink_source.txt");
+    std::string destination = path::joinPath(temp_path, "reflink_destination.txt");
+    path::createFile(source, "Hello !name!", path::CopyOption::OverwriteAll);
+
+    path::CopyMethod method;
+    path::setReflinkOption(path::ReflinkOption::Never);
+    ASSERT_TRUE(path::copyFile(source, destination, &method));
+    EXPECT_NE(method, path::CopyMethod::Reflink);
+    EXPECT_EQ(helper::readTextFromFile(destination), "Hello !name!");
+
+    // Falls back to a copy if the filesystem cannot clone
+    path::setReflinkOption(path::ReflinkOption::Auto);
+    ASSERT_TRUE(path::copyFile(source, destination, &method));
+    EXPECT_EQ(helper::readTextFromFile(destination), "Hello !name!");
+    bool cloned = method == path::CopyMethod::Reflink;
+
+    path::setReflinkOption(path::ReflinkOption::Always);
+    if(cloned) {
+        EXPECT_TRUE(path::copyFile(source, destination, &method));
+        EXPECT_EQ(method, path::CopyMethod::Reflink);
+    } else {
+        EXPECT_THROW(path::copyFile(source, destination), std::runtime_error);
+    }
+
+    path::setReflinkOption(path::ReflinkOption::Auto);
+    path::remove(source);
+    path::remove(destination);
+}
+
+TEST(copyFile, keeps_holes_of_sparse_files)
+{
+    std::string source = path::joinPath(temp_path, "sparse_source");
+    std::string destination = path::joinPath(temp_path, "sparse_destination");
+    const std::uintmax_t size = 16 * 1024 * 1024;
+    path::createDirectory(source);
+    path::createDirectory(destination);
+    {
+        std::ofstream file(path::joinPath(source, "disk.img"), std::ios::binary);
+        file << "head";
+        file.seekp(8 * 1024 * 1024);
+        file << "middle";
+    }
+    std::filesystem::resize_file(path::joinPath(source, "disk.img"), size);
+    std::string content = helper::readTextFromFile(path::joinPath(source, "disk.img"));
+
+    path::CopyMethod method;
+    ASSERT_TRUE(path::copyFile(path::joinPath(source, "disk.img"), path::joinPath(destination, "copy.img"), &method));
+    path::setIoBackend(path::IoBackend::IoUring);
+    EXPECT_TRUE(path::copy(source, {"disk.img"}, destination, path::CopyOption::OverwriteExisting));
+    path::setIoBackend(path::IoBackend::Threads);
+
+    for(const char* i : {"copy.img", "disk.img"}) {
+        std::string copy = path::joinPath(destination, i);
+        EXPECT_EQ(std::filesystem::file_size(copy), size) << i;
+        EXPECT_TRUE(helper::readTextFromFile(copy) == content) << i;
+        #if defined(__linux__)
+            // Only check the holes if the filesystem made the source sparse
+            struct stat info;
+            ASSERT_EQ(::stat(path::joinPath(source, "disk.img").c_str(), &info), 0);
+            if(info.st_blocks * 512 < info.st_size) {
+                EXPECT_EQ(method, path::CopyMethod::Sparse);
+                ASSERT_EQ(::stat(copy.c_str(), &info), 0);
+                EXPECT_LT(info.st_blocks * 512, info.st_size) << i;
+            }
+        #endif
+    }
+
+    path::remove(source);
+    path::remove(destination);
+}
+
+TEST(isBinaryData, work)
+{
+    std::string text = "Hello !name!\n\tcaf\xc3\xa9\r\n";
+    std::string nul = std::string("Hello !name!") + '\0' + "data";
+    std::string noise(64, '\x01');
+    std::string latin = std::string(32, '\xe9');
+
+    EXPECT_FALSE(helper::isBinaryData(text.data(), text.size()));
+    EXPECT_FALSE(helper::isBinaryData("", 0));
+    EXPECT_TRUE(helper::isBinaryData(nul.data(), nul.size()));
+    EXPECT_TRUE(helper::isBinaryData(noise.data(), noise.size()));
+    // Text in a legacy 8-bit encoding is not valid UTF-8 but is still text
+    EXPECT_FALSE(helper::isBinaryData(latin.data(), latin.size()));
+}
+
+TEST(replaceVariablesInFile, skip_binary_files)
+{
+    path::createDirectory(temp_path);
+    std::string file = path::joinPath(temp_path, "binary.dat");
+    std::string content = std::string("Hello !name!") + '\0' + "!name!";
+    std::ofstream(file, std::ios::binary) << content;
+
+    EXPECT_FALSE(helper::replaceVariablesInFile(file, {{"name", "User"}}, "!", "!"));
+    EXPECT_EQ(helper::readTextFromFile(file), content);
+
+    path::remove(file);
+}
+
+TEST(replaceVariablesInFile, legacy_encodings_are_text)
+{
+    path::createDirectory(temp_path);
+    std::string file = path::joinPath(temp_path, "cp1251.txt");
+    // "Привет, !name!" in CP1251, where nearly every byte is invalid UTF-8
+    std::string content = "\xcf\xf0\xe8\xe2\xe5\xf2, !name!\r\n";
+
+    EXPECT_FALSE(helper::isBinaryData(content.data(), content.size()));
+    std::ofstream(file, std::ios::binary) << content;
+    EXPECT_TRUE(helper::replaceVariablesInFile(file, {{"name", "User"}}, "!", "!"));
+    EXPECT_EQ(helper::readTextFromFile(file), "\xcf\xf0\xe8\xe2\xe5\xf2, User\r\n");
+
+    path::remove(file);
+}
+
 TEST(matchPaths, work)
 {
     std::string template_p = path::joinPath(template_path, "cpp-test");
@@ -493,6 +1336,158 @@ TEST(matchPaths, include_and_exclude_non_patterns)
     EXPECT_EQ(actual, expected);
 }
 
+TEST(matchPaths, skipped_directories_do_not_change_matches)
+{
+    std::string root = path::joinPath(temp_path, "pruned_walk");
+    for(const char* i : {"src/app", "src/lib/deep", "build/obj/x", "node_modules/pkg/lib", "include", "docs"}) {
+        std::filesystem::create_directories(std::filesystem::path(root) / i);
+        std::ofstream(std::filesystem::path(root) / i / "file.cpp") << i;
+        std::ofstream(std::filesystem::path(root) / i / "notes.txt") << i;
+    }
+    std::set<std::string> all = helper::getPaths(root, root);
+
+    std::vector<std::pair<std::set<std::string>, std::set<std::string>>> filters = {
+        {{"**"}, {"build/**", "node_modules/**"}},
+        {{"src/**", "include"}, {"src/lib/**"}},
+        {{"src/*/file.cpp", "docs/notes.txt"}, {}},
+        {{"*/*/deep/*"}, {"**/notes.txt"}},
+        {{"**/file.cpp"}, {"*/pkg/**"}},
+        {{"**"}, {"**"}},
+        {{"build/obj"}, {"build/obj/**"}},
+        {{}, {}}
+    };
+
+    for(const auto& i : filters) {
+        std::set<std::string> expected;
+        for(const auto& p : all) {
+            bool included = std::any_of(i.first.begin(), i.first.end(), [&](const std::string& pattern) {
+                return fmatch::match(p, path::normalizePath(pattern));
+            });
+            bool excluded = std::any_of(i.second.begin(), i.second.end(), [&](const std::string& pattern) {
+                return fmatch::match(p, path::normalizePath(pattern));
+            });
+            if(included && !excluded) {
+                expected.insert(p);
+            }
+        }
+
+        helper::PathFilter filter(i.first, i.second);
+        EXPECT_EQ(helper::matchPaths(all, filter), expected);
+        EXPECT_EQ(helper::getMatchingPaths(root, filter).toSet(), expected);
+        EXPECT_EQ(helper::getMatchingPaths(root, filter, 3).toSet(), expected);
+    }
+
+    helper::PathFilter filter({"**"}, {"build/**"});
+    EXPECT_TRUE(filter.skipsContents("build"));
+    EXPECT_TRUE(filter.skipsContents(path::normalizePath("build/obj")));
+    EXPECT_FALSE(filter.skipsContents("src"));
+
+    helper::PathFilter includes({"src/*/file.cpp", path::normalizePath("docs/a/b.txt")}, {});
+    EXPECT_FALSE(includes.skipsContents("src"));
+    EXPECT_FALSE(includes.skipsContents(path::normalizePath("src/app")));
+    EXPECT_TRUE(includes.skipsContents(path::normalizePath("src/app/more")));
+    EXPECT_TRUE(includes.skipsContents("build"));
+    EXPECT_FALSE(includes.skipsContents(path::normalizePath("docs/a")));
+    EXPECT_TRUE(includes.skipsContents(path::normalizePath("docs/b")));
+
+    path::remove(root);
+}
+
+TEST(PathTable, behaves_like_a_sorted_set)
+{
+    std::mt19937 rng(24);
+    std::set<std::string> a;
+    std::set<std::string> b;
+    for(int i = 0; i < 2000; i++) {
+        std::string p = "dir" + std::to_string(rng() % 7) + "/sub" + std::to_string(rng() % 13) + "/file" + std::to_string(rng() % 50) + ".txt";
+        (rng() % 2 == 0 ? a : b).insert(p);
+        if(rng() % 5 == 0) {
+            a.insert(p);
+            b.insert(p);
+        }
+    }
+
+    pathtable::PathTable table(a);
+    ASSERT_EQ(table.size(), a.size());
+    EXPECT_EQ(table.toSet(), a);
+    EXPECT_EQ(pathtable::PathTable(std::vector<std::string>(a.rbegin(), a.rend())), table);
+
+    std::size_t id = 0;
+    for(auto it = table.begin(); it != table.end(); ++it, id++) {
+        EXPECT_EQ(it.id(), id);
+        EXPECT_EQ(table[id], *it);
+        EXPECT_EQ(table.find(*it), id);
+        EXPECT_EQ(table.lowerBound(*it + "\x01"), id + 1);
+    }
+    EXPECT_EQ(table.find("dir9"), pathtable::PathTable::npos);
+    EXPECT_EQ(table.count("dir9"), 0);
+    EXPECT_EQ(table.lowerBound(""), 0);
+    EXPECT_EQ(table.lowerBound("zzz"), table.size());
+    EXPECT_THROW(table.push_back("a"), std::invalid_argument);
+
+    std::set<std::string> expected;
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+    EXPECT_EQ(pathtable::unite(table, b).toSet(), expected);
+    expected.clear();
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+    EXPECT_EQ(pathtable::intersect(table, b).toSet(), expected);
+    expected.clear();
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::inserter(expected, expected.end()));
+    EXPECT_EQ(pathtable::subtract(table, b).toSet(), expected);
+
+    // Paths that share their directories take a fraction of their length
+    std::size_t length = 0;
+    for(const auto& i : a) {
+        length += i.size();
+    }
+    EXPECT_LT(table.memoryUsage(), length / 2);
+
+    EXPECT_TRUE(pathtable::PathTable().empty());
+    EXPECT_EQ(pathtable::PathTable({"b", "a", "b"}).toSet(), std::set<std::string>({"a", "b"}));
+}
+
+TEST(PathTree, directories_hold_their_contents)
+{
+    // "a-c" and "a.txt" sort between "a" and "a/b" as strings, but not in the tree
+    pathtable::PathTable paths({"a", "a-c", "a.txt", "a/b", "a/b/c.txt", "a/d.txt", "x/y/z.txt"});
+    pathtable::PathTree tree(paths);
+
+    // "x" and "x/y" are not in the table but still get a node
+    ASSERT_EQ(tree.size(), 10);
+    std::size_t a = tree.find("a");
+    ASSERT_NE(a, pathtable::PathTree::npos);
+    EXPECT_EQ(tree.id(a), paths.find("a"));
+    EXPECT_EQ(tree.id(tree.find("x/y")), pathtable::PathTree::npos);
+    EXPECT_EQ(tree.find("a/c"), pathtable::PathTree::npos);
+    EXPECT_EQ(tree.path(tree.find("a/b/c.txt")), "a/b/c.txt");
+    EXPECT_EQ(tree.parent(tree.find("a/b")), a);
+
+    ASSERT_EQ(tree.childCount(a), 2);
+    EXPECT_EQ(tree.name(tree.child(a, 0)), "b");
+    EXPECT_EQ(tree.name(tree.child(a, 1)), "d.txt");
+    EXPECT_EQ(tree.subtreeEnd(a) - a, 4);
+    EXPECT_EQ(tree.idsUnder("a"), std::vector<std::size_t>({paths.find("a/b"), paths.find("a/b/c.txt"), paths.find("a/d.txt")}));
+    EXPECT_TRUE(tree.idsUnder("b").empty());
+
+    std::vector<std::string> visited;
+    tree.forEach([&](std::size_t, const std::string& p) {
+        visited.push_back(p);
+        return p != "a/b";
+    });
+    EXPECT_EQ(visited, std::vector<std::string>({"a", "a/b", "a/d.txt", "a-c", "a.txt", "x", "x/y", "x/y/z.txt"}));
+
+    std::vector<std::size_t> order;
+    tree.forEachBottomUp([&](std::size_t node) {
+        order.push_back(node);
+    });
+    ASSERT_EQ(order.size(), tree.size() - 1);
+    for(std::size_t i = 0; i < order.size(); i++) {
+        for(std::size_t j = i + 1; j < order.size(); j++) {
+            EXPECT_FALSE(order[i] < order[j] && order[j] < tree.subtreeEnd(order[i])) << tree.path(order[i]) << " before " << tree.path(order[j]);
+        }
+    }
+}
+
 TEST(replaceVariablesInAllFilenames, working)
 {
     std::string testing_path = path::joinPath(test_path, "test_suites/replace_filenames");